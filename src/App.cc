@@ -104,9 +104,25 @@ namespace pge {
       info("This is game over");
     }
 
+    consumeSimulationSteps();
+
     return m_game->terminated();
   }
 
+  void
+  App::consumeSimulationSteps() {
+    eqdif::StepChannel& channel = m_game->getSimulation().getStepChannel();
+    const unsigned variables = channel.variables();
+
+    channel.drain(
+      [this, variables](const float* step) {
+        for (unsigned id = 0u ; id < m_eqViews.size() ; ++id) {
+          m_eqViews[id]->handleSimulationStep(step, variables);
+        }
+      }
+    );
+  }
+
   void
   App::onInputs(const controls::State& c,
                 const CoordinateFrame& cf)
@@ -158,6 +174,11 @@ namespace pge {
         m_state->save();
       }
     }
+    if (c.keys[controls::keys::W]) {
+      if (m_state->getScreen() == Screen::Game) {
+        m_game->toggleStreaming();
+      }
+    }
   }
 
   void
@@ -186,14 +207,14 @@ namespace pge {
         variables[id]
       );
 
-      sim.onSimulationStep.connect_member<EquationView>(
+      m_game->onSimulationReset.connect_member<EquationView>(
         view.get(),
-        &EquationView::handleSimulationStep
+        &EquationView::handleSimulationReset
       );
 
-      m_game->onSimulationReset.connect_member<EquationView>(
+      sim.onSimulationLoaded.connect_member<EquationView>(
         view.get(),
-        &EquationView::handleSimulationReset
+        &EquationView::handleSimulationLoaded
       );
 
       m_eqViews.push_back(view);
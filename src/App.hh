@@ -115,6 +115,16 @@ namespace pge {
       drawRect(const SpriteDesc& t,
                const CoordinateFrame& cf);
 
+      /**
+       * @brief - Transfer the steps computed by the simulation since
+       *          the last frame to the views of the equations. This
+       *          is the only place where the views are updated with
+       *          new steps so that they are only ever accessed from
+       *          the rendering thread.
+       */
+      void
+      consumeSimulationSteps();
+
     private:
 
       /**
@@ -22,6 +22,7 @@ namespace pge {
         P,
         R,
         S,
+        W,
 
         KeysCount
       };
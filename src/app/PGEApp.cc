@@ -208,6 +208,9 @@ namespace pge {
     b = GetKey(olc::S);
     m_controls.keys[controls::keys::S] = b.bReleased;
 
+    b = GetKey(olc::W);
+    m_controls.keys[controls::keys::W] = b.bReleased;
+
     b = GetKey(olc::TAB),
     m_controls.tab = b.bReleased;
 
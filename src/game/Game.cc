@@ -14,17 +14,47 @@ namespace {
 /// @brief - The height of the main menu.
 constexpr auto STATUS_MENU_HEIGHT = 50;
 
-/// @brief - The maximum speed for the simulation.
-constexpr auto MAX_SIMULATION_SPEED = 32.0f;
+/// @brief - The maximum speed for the simulation. Speeding up
+/// the simulation computes more steps in each frame rather than
+/// more frames, so this is not bound by the scheduler.
+constexpr auto MAX_SIMULATION_SPEED = 1024.0f;
 
 constexpr auto RESET_SIMULATION_TEXT = "Reset";
 constexpr auto NEXT_STEP_SIMULATION_TEXT = "Next step";
 
+constexpr auto SAVE_SIMULATION_TEXT = "Saving: ";
+
 constexpr auto START_SIMULATION_TEXT = "Start";
 constexpr auto PAUSE_SIMULATION_TEXT = "Pause";
 
 constexpr auto DESIRED_SIMULATION_FPS = 80.0f;
 
+/// @brief - The number of simulation steps kept at full resolution:
+/// older steps are decimated so that long runs use a bounded amount
+/// of memory. At the default framerate this is a bit more than three
+/// hours of simulation.
+constexpr auto FULL_RESOLUTION_STEPS = 1u << 20u;
+
+/// @brief - The number of steps summarized by each bucket of the
+/// first level of decimated data.
+constexpr auto DECIMATION_FACTOR = 16u;
+
+/// @brief - The number of buckets in each level of decimated data.
+constexpr auto DECIMATED_BUCKETS_PER_LEVEL = 4096u;
+
+/// @brief - Whether saved simulations keep being written to disk
+/// as the simulation runs when the game starts. This can then be
+/// toggled by the user.
+constexpr auto STREAM_SAVED_SIMULATIONS = false;
+
+/// @brief - The number of steps written at once when streaming a
+/// simulation to disk.
+constexpr auto STREAMING_BLOCK_STEPS = 4096u;
+
+/// @brief - The maximum duration during which steps can stay in
+/// memory before being written when streaming a simulation.
+constexpr auto STREAMING_FLUSH_INTERVAL_MS = 1000;
+
   pge::MenuShPtr
   generateMenu(const olc::vi2d& pos,
                const olc::vi2d& size,
@@ -89,18 +119,37 @@ namespace pge {
         1.0f,  // speed
         false, // wasRunning
         false, // resetTriggered
+        false, // saveTriggered
+        STREAM_SAVED_SIMULATIONS, // streaming
       }
     ),
 
     m_menus(),
 
-    m_simulation(eqdif::SimulationMethod::RUNGE_KUTTA_4),
+    m_saveCompleted(false),
+
+    m_simulation(eqdif::SimulationMethod::AUTOMATIC),
     m_launcher(&m_simulation,
                DESIRED_SIMULATION_FPS,
                1000.0f / DESIRED_SIMULATION_FPS,
                eqdif::time::Unit::Millisecond)
   {
     setService("game");
+
+    m_simulation.setRetentionPolicy(
+      eqdif::RetentionPolicy{
+        FULL_RESOLUTION_STEPS,      // fullResolutionSteps
+        DECIMATION_FACTOR,          // decimationFactor
+        DECIMATED_BUCKETS_PER_LEVEL // bucketsPerLevel
+      }
+    );
+
+    // Old steps of the history are rarely accessed and consecutive
+    // steps are close to each other: they compress well.
+    m_simulation.setCompression(
+      eqdif::losslessCompression(eqdif::Encoding::Delta),
+      eqdif::losslessCompression(eqdif::Encoding::Delta)
+    );
   }
 
   Game::~Game() {}
@@ -160,17 +209,35 @@ namespace pge {
     );
     m_menus.resetAlert.menu->setVisible(false);
 
+    m_menus.save = generateMenu(pos, dims, "", "save", buttonBG);
+    m_menus.save->setVisible(false);
+
+    m_menus.saveAlert.date = utils::TimeStamp();
+    m_menus.saveAlert.wasActive = false;
+    m_menus.saveAlert.duration = ALERT_DURATION_MS;
+
+    m_menus.saveAlert.menu = generateMessageBoxMenu(
+      olc::vi2d((width - 300.0f) / 2.0f, (height - 150.0f) / 2.0f),
+      olc::vi2d(300, 150),
+      "Simulation saved",
+      "saved",
+      false
+    );
+    m_menus.saveAlert.menu->setVisible(false);
+
     status->addMenu(m_menus.reset);
     status->addMenu(m_menus.speed);
     status->addMenu(m_menus.timestamp);
     status->addMenu(m_menus.nextStep);
     status->addMenu(m_menus.startPause);
+    status->addMenu(m_menus.save);
 
     // Package menus for output.
     std::vector<MenuShPtr> menus;
 
     menus.push_back(status);
     menus.push_back(m_menus.resetAlert.menu);
+    menus.push_back(m_menus.saveAlert.menu);
 
     return menus;
   }
@@ -258,14 +325,54 @@ namespace pge {
   }
 
   void
-  Game::save(const std::string& file) const {
+  Game::save(const std::string& file) {
+    // The snapshot of the simulation is taken by the operation,
+    // which does not run while steps are computed: the file is
+    // then written in the background.
+    eqdif::SaveCallback callback = [this](const std::string& /*file*/, bool success) {
+      if (success) {
+        m_saveCompleted = true;
+      }
+    };
+
+    const bool streaming = m_state.streaming;
+
     m_launcher.performOperation(
-      [&file](eqdif::Process& p) {
-        dynamic_cast<eqdif::Simulation&>(p).save(file);
+      [&file, &callback, streaming](eqdif::Process& p) {
+        eqdif::Simulation& sim = dynamic_cast<eqdif::Simulation&>(p);
+
+        if (!streaming) {
+          sim.saveAsync(file, callback);
+          return;
+        }
+
+        sim.stream(
+          file,
+          eqdif::StreamingPolicy{
+            STREAMING_BLOCK_STEPS,                             // blockSteps
+            utils::toMilliseconds(STREAMING_FLUSH_INTERVAL_MS) // flushInterval
+          },
+          callback
+        );
       }
     );
   }
 
+  void
+  Game::toggleStreaming() {
+    m_state.streaming = !m_state.streaming;
+
+    if (m_state.streaming) {
+      info("Saved simulations will keep being written as the simulation runs");
+      return;
+    }
+
+    // The steps computed from now on should not be appended to
+    // the last save file.
+    m_simulation.stopStreaming();
+    info("Saved simulations will only hold the steps computed so far");
+  }
+
   void
   Game::speedUpSimulation() noexcept {
     // Only available when the game is not paused.
@@ -280,11 +387,9 @@ namespace pge {
       m_state.speed = 1.0f;
     }
 
-    // Update the desired FPS for the simulation. Note
-    // that the current framerate already includes the
-    // current speed.
-    float baseFPS = m_launcher.desiredFPS() / s;
-    m_launcher.setDesiredFramerate(baseFPS * m_state.speed);
+    // The duration of a step matches the duration of a frame
+    // so the speed is directly the rate of the simulated time.
+    m_launcher.setTimeRate(m_state.speed);
 
     info(
       "Simulation speed updated from " + std::to_string(s) +
@@ -327,9 +432,17 @@ namespace pge {
     const auto state = m_launcher.state();
 
     switch (state) {
-      case eqdif::State::Running:
+      case eqdif::State::Running: {
+        const eqdif::RateStatistics rate = m_launcher.rateStatistics();
+        info(
+          "Simulation ran at " + std::to_string(rate.achieved) + " fps (desired " +
+          std::to_string(rate.desired) + "), " + std::to_string(rate.overruns) + " overrun(s) and " +
+          std::to_string(rate.dropped) + " dropped frame(s) out of " + std::to_string(rate.frames) +
+          " with " + std::to_string(rate.stepsPerFrame) + " step(s) per frame"
+        );
+
         m_launcher.pause();
-        break;
+        } break;
       case eqdif::State::Paused:
         m_launcher.resume();
         break;
@@ -388,6 +501,19 @@ namespace pge {
     m_menus.startPause->setText(text);
 
     m_state.resetTriggered = m_menus.resetAlert.update(m_state.resetTriggered);
+
+    // Display the progress of the save in progress if any.
+    const bool saving = m_simulation.saving();
+    m_menus.save->setVisible(saving);
+    if (saving) {
+      int progress = static_cast<int>(std::round(100.0f * m_simulation.saveProgress()));
+      m_menus.save->setText(SAVE_SIMULATION_TEXT + std::to_string(progress) + "%");
+    }
+
+    if (m_saveCompleted.exchange(false)) {
+      m_state.saveTriggered = true;
+    }
+    m_state.saveTriggered = m_menus.saveAlert.update(m_state.saveTriggered);
   }
 
   bool
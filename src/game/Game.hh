@@ -1,6 +1,7 @@
 #ifndef    GAME_HH
 # define   GAME_HH
 
+# include <atomic>
 # include <vector>
 # include <memory>
 # include <core_utils/CoreObject.hh>
@@ -120,11 +121,24 @@ namespace pge {
 
       /**
        * @brief - Save the current state of the board to a default
-       *          file with the name provided in input.
+       *          file with the name provided in input. The file is
+       *          written in the background from a snapshot so that
+       *          the simulation keeps running. If streaming is on the
+       *          steps computed afterwards are then appended to the
+       *          file until the simulation is reset, another one is
+       *          loaded or saved or streaming is turned off.
        * @param file - the file to save the board into.
        */
       void
-      save(const std::string& file) const;
+      save(const std::string& file);
+
+      /**
+       * @brief - Toggle whether the saved simulations keep being
+       *          written to disk as the simulation runs. Turning it
+       *          off stops appending steps to the last save file.
+       */
+      void
+      toggleStreaming();
 
       void
       speedUpSimulation() noexcept;
@@ -223,6 +237,14 @@ namespace pge {
 
         // Whether or not a reset event was triggered.
         bool resetTriggered;
+
+        // Whether or not a save completed since the last update
+        // of the UI.
+        bool saveTriggered;
+
+        // Whether or not the steps computed after a save are
+        // appended to the save file.
+        bool streaming;
       };
 
       /// @brief - Convenience structure allowing to regroup
@@ -238,7 +260,11 @@ namespace pge {
 
         MenuShPtr startPause;
 
+        MenuShPtr save;
+
         TimedMenu resetAlert;
+
+        TimedMenu saveAlert;
       };
 
       /**
@@ -252,6 +278,14 @@ namespace pge {
        */
       Menus m_menus;
 
+      /**
+       * @brief - Set by the thread writing a save when it completes:
+       *          the UI is then updated on the next frame. Declared
+       *          before the simulation as it is accessed until
+       *          the simulation is destroyed.
+       */
+      std::atomic<bool> m_saveCompleted;
+
       /**
        * @brief - The model to simulate.
        */
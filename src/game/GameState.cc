@@ -128,6 +128,12 @@ namespace pge {
   {
     menu::InputHandle res{false, false};
 
+    // Pick up the result of the background scan of the saved
+    // games if it completed.
+    if (m_screen == Screen::LoadGame) {
+      m_savedGames.synchronize();
+    }
+
     // Propagate the user input to each screen.
     menu::InputHandle cur = m_home->processUserInput(c, actions);
     res.relevant = (res.relevant || cur.relevant);
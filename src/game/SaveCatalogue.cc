@@ -0,0 +1,294 @@
+
+# include "SaveCatalogue.hh"
+# include <cstdio>
+# include <fstream>
+# include <algorithm>
+# include <filesystem>
+# include <unordered_map>
+# include <core_utils/TimeUtils.hh>
+# include "SaveFile.hh"
+
+namespace {
+
+  /// @brief - The name of the file holding the persisted index, in
+  /// the directory of the saved games.
+  constexpr auto CATALOGUE_INDEX_FILE = ".catalogue";
+
+  /// @brief - The magic bytes at the start of the index.
+  constexpr char CATALOGUE_MAGIC[8] = {'E', 'Q', 'D', 'I', 'F', 'C', 'A', 'T'};
+
+  /// @brief - The version of the format of the index.
+  constexpr std::uint32_t CATALOGUE_VERSION = 1u;
+
+}
+
+namespace pge {
+
+  // Convenience using to shorten the usage of the filesystem
+  // data types when scanning the saved games.
+  using DirIt = std::filesystem::directory_iterator;
+
+  SaveCatalogue::SaveCatalogue(const std::string& dir,
+                               const std::string& ext):
+    utils::CoreObject("catalogue"),
+
+    m_dir(dir),
+    m_ext(ext),
+    m_index(dir + "/" + CATALOGUE_INDEX_FILE),
+
+    m_locker(),
+    m_notifier(),
+    m_entries(),
+    m_revision(0u),
+    m_scanRequested(false),
+    m_stopRequested(false),
+    m_thread()
+  {
+    setService("saves");
+
+    load();
+
+    m_thread = std::thread(&SaveCatalogue::asynchronousScanningLoop, this);
+  }
+
+  SaveCatalogue::~SaveCatalogue() {
+    {
+      UniqueGuard guard(m_locker);
+      m_stopRequested = true;
+    }
+
+    m_notifier.notify_one();
+    m_thread.join();
+  }
+
+  void
+  SaveCatalogue::scan() {
+    {
+      UniqueGuard guard(m_locker);
+      m_scanRequested = true;
+    }
+
+    m_notifier.notify_one();
+  }
+
+  std::size_t
+  SaveCatalogue::size() const {
+    UniqueGuard guard(m_locker);
+    return m_entries.size();
+  }
+
+  std::vector<SaveEntry>
+  SaveCatalogue::page(std::size_t first, std::size_t count) const {
+    UniqueGuard guard(m_locker);
+
+    first = std::min(first, m_entries.size());
+    count = std::min(count, m_entries.size() - first);
+
+    return std::vector<SaveEntry>(m_entries.begin() + first, m_entries.begin() + first + count);
+  }
+
+  unsigned
+  SaveCatalogue::revision() const noexcept {
+    return m_revision;
+  }
+
+  void
+  SaveCatalogue::asynchronousScanningLoop() {
+    bool done = false;
+    while (!done) {
+      {
+        UniqueGuard guard(m_locker);
+        m_notifier.wait(
+          guard,
+          [this]() {
+            return m_stopRequested || m_scanRequested;
+          }
+        );
+
+        done = m_stopRequested;
+        m_scanRequested = false;
+      }
+
+      if (!done) {
+        withSafetyNet(
+          [this]() {
+            update();
+          },
+          "update"
+        );
+      }
+    }
+  }
+
+  void
+  SaveCatalogue::update() {
+    utils::TimeStamp start = utils::now();
+
+    std::unordered_map<std::string, SaveEntry> known;
+    {
+      UniqueGuard guard(m_locker);
+      for (const SaveEntry& entry : m_entries) {
+        known.emplace(entry.name, entry);
+      }
+    }
+
+    // Only the files which were modified since they were indexed
+    // have their header read.
+    std::vector<SaveEntry> entries;
+    entries.reserve(known.size());
+    unsigned read = 0u;
+
+    std::error_code code;
+    DirIt end;
+    for (DirIt it(m_dir, code) ; !code && it != end ; it.increment(code)) {
+      const std::filesystem::path& path = it->path();
+      if (path.extension() != "." + m_ext) {
+        continue;
+      }
+
+      const std::string name = path.stem().string();
+      const std::int64_t mtime = it->last_write_time(code).time_since_epoch().count();
+
+      if (name.empty() || code) {
+        warn("Failed to interpret saved game \"" + path.string() + "\"");
+        code.clear();
+        continue;
+      }
+
+      auto existing = known.find(name);
+      if (existing != known.end() && existing->second.mtime == mtime) {
+        entries.push_back(existing->second);
+        continue;
+      }
+
+      SaveEntry entry{name, mtime, false, false, eqdif::SimulationMethod::EULER, 0u, 0u};
+
+      eqdif::SaveFileSummary summary;
+      if (eqdif::readSummary(path.string(), summary)) {
+        entry.valid = true;
+        entry.legacy = summary.legacy;
+        entry.method = summary.method;
+        entry.variables = summary.variables.size();
+        entry.steps = summary.steps;
+      }
+
+      entries.push_back(entry);
+      ++read;
+    }
+
+    if (code) {
+      warn(
+        "Failed to scan directory \"" + m_dir + "\" for saved games",
+        code.message()
+      );
+    }
+
+    std::sort(
+      entries.begin(),
+      entries.end(),
+      [](const SaveEntry& lhs, const SaveEntry& rhs) {
+        return lhs.name < rhs.name;
+      }
+    );
+
+    const bool changed = (read > 0u || entries.size() != known.size());
+    if (changed) {
+      persist(entries);
+
+      {
+        UniqueGuard guard(m_locker);
+        m_entries.swap(entries);
+      }
+
+      ++m_revision;
+    }
+
+    info(
+      "Scanned directory \"" + m_dir + "\" in " + utils::durationToMsString(utils::now() - start) +
+      ", read " + std::to_string(read) + " header(s) out of " + std::to_string(size()) +
+      " saved game(s)"
+    );
+  }
+
+  void
+  SaveCatalogue::load() {
+    std::ifstream in(m_index.c_str(), std::ios::binary);
+    if (!in.good()) {
+      return;
+    }
+
+    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    eqdif::SaveFileReader reader(data.data(), data.size());
+
+    const char* magic = nullptr;
+    std::uint32_t version = 0u, count = 0u;
+
+    if (!reader.view(sizeof(CATALOGUE_MAGIC), magic) ||
+        !std::equal(magic, magic + sizeof(CATALOGUE_MAGIC), CATALOGUE_MAGIC) ||
+        !reader.read(version) || version != CATALOGUE_VERSION ||
+        !reader.read(count))
+    {
+      warn("Ignoring invalid index \"" + m_index + "\"");
+      return;
+    }
+
+    std::vector<SaveEntry> entries;
+    for (unsigned id = 0u ; id < count ; ++id) {
+      SaveEntry entry{"", 0, false, false, eqdif::SimulationMethod::EULER, 0u, 0u};
+      std::uint8_t valid = 0u, legacy = 0u;
+      std::uint32_t method = 0u, variables = 0u;
+
+      if (!reader.read(entry.name) || !reader.read(entry.mtime) ||
+          !reader.read(valid) || !reader.read(legacy) ||
+          !reader.read(method) || !reader.read(variables) ||
+          !reader.read(entry.steps))
+      {
+        warn("Ignoring truncated index \"" + m_index + "\"");
+        return;
+      }
+
+      entry.valid = (valid != 0u);
+      entry.legacy = (legacy != 0u);
+      entry.method = static_cast<eqdif::SimulationMethod>(method);
+      entry.variables = variables;
+
+      entries.push_back(entry);
+    }
+
+    m_entries.swap(entries);
+
+    info("Loaded " + std::to_string(m_entries.size()) + " saved game(s) from index \"" + m_index + "\"");
+  }
+
+  void
+  SaveCatalogue::persist(const std::vector<SaveEntry>& entries) const {
+    // Write to a temporary file so that the index is never left
+    // incomplete.
+    const std::string temporary = m_index + ".tmp";
+
+    std::ofstream out(temporary.c_str(), std::ios::binary);
+    eqdif::SaveFileWriter writer(out);
+
+    out.write(CATALOGUE_MAGIC, sizeof(CATALOGUE_MAGIC));
+    writer.write(CATALOGUE_VERSION);
+    writer.write(static_cast<std::uint32_t>(entries.size()));
+
+    for (const SaveEntry& entry : entries) {
+      writer.write(entry.name);
+      writer.write(entry.mtime);
+      writer.write(static_cast<std::uint8_t>(entry.valid));
+      writer.write(static_cast<std::uint8_t>(entry.legacy));
+      writer.write(static_cast<std::uint32_t>(entry.method));
+      writer.write(static_cast<std::uint32_t>(entry.variables));
+      writer.write(entry.steps);
+    }
+
+    out.close();
+
+    if (out.fail() || std::rename(temporary.c_str(), m_index.c_str()) != 0) {
+      std::remove(temporary.c_str());
+      warn("Failed to persist index \"" + m_index + "\"");
+    }
+  }
+
+}
@@ -0,0 +1,169 @@
+#ifndef    SAVE_CATALOGUE_HH
+# define   SAVE_CATALOGUE_HH
+
+# include <mutex>
+# include <atomic>
+# include <string>
+# include <thread>
+# include <vector>
+# include <cstdint>
+# include <condition_variable>
+# include <core_utils/CoreObject.hh>
+# include "System.hh"
+
+namespace pge {
+
+  /// @brief - The description of a saved game as registered in the
+  /// catalogue.
+  struct SaveEntry {
+    /// @brief - The name of the file, without the directory and the
+    /// extension.
+    std::string name;
+
+    /// @brief - The last modification time of the file, used to find
+    /// out whether the entry is up to date.
+    std::int64_t mtime;
+
+    /// @brief - Whether the header of the file could be read. Other
+    /// properties are meaningless otherwise.
+    bool valid;
+
+    /// @brief - Whether the file uses the legacy format.
+    bool legacy;
+
+    /// @brief - The simulation method used to produce the steps.
+    eqdif::SimulationMethod method;
+
+    /// @brief - The number of variables of the simulation.
+    unsigned variables;
+
+    /// @brief - The number of steps of the simulation.
+    std::uint64_t steps;
+  };
+
+  /// @brief - Keeps an index of the saved games of a directory, so
+  /// that the list of games can be displayed without listing the
+  /// directory and reading each file. The index is persisted in the
+  /// directory and updated incrementally by a background thread:
+  /// only the files which were modified since the last scan have
+  /// their header read again.
+  class SaveCatalogue: public utils::CoreObject {
+    public:
+
+      /**
+       * @brief - Create a catalogue for the input directory. The
+       *          persisted index is loaded if it exists, no scan is
+       *          performed until requested.
+       * @param dir - the directory where games are stored.
+       * @param ext - the extension of the saved games files.
+       */
+      SaveCatalogue(const std::string& dir,
+                    const std::string& ext);
+
+      /**
+       * @brief - Stop the scanning thread.
+       */
+      ~SaveCatalogue();
+
+      /**
+       * @brief - Request the directory to be scanned in the background.
+       *          The entries are replaced once the scan completes and
+       *          the revision is incremented.
+       */
+      void
+      scan();
+
+      /**
+       * @brief - The number of saved games in the catalogue.
+       * @return - the number of entries.
+       */
+      std::size_t
+      size() const;
+
+      /**
+       * @brief - Retrieve a range of entries, sorted by name.
+       * @param first - the index of the first entry to retrieve.
+       * @param count - the maximum number of entries to retrieve.
+       * @return - the entries, fewer than `count` if the end of the
+       *           catalogue is reached.
+       */
+      std::vector<SaveEntry>
+      page(std::size_t first, std::size_t count) const;
+
+      /**
+       * @brief - Incremented each time the entries change: allows to
+       *          detect that a scan completed.
+       * @return - the current revision.
+       */
+      unsigned
+      revision() const noexcept;
+
+    private:
+
+      /**
+       * @brief - Executed by the scanning thread: wait for scan
+       *          requests and process them.
+       */
+      void
+      asynchronousScanningLoop();
+
+      /**
+       * @brief - List the directory and build the new entries, reusing
+       *          the existing ones for files which were not modified.
+       */
+      void
+      update();
+
+      /**
+       * @brief - Load the persisted index, if any.
+       */
+      void
+      load();
+
+      /**
+       * @brief - Persist the entries to the index.
+       * @param entries - the entries to persist.
+       */
+      void
+      persist(const std::vector<SaveEntry>& entries) const;
+
+    private:
+
+      /// @brief - Convenience define for a unique lock.
+      using UniqueGuard = std::unique_lock<std::mutex>;
+
+      /// @brief - The directory where saved games are stored.
+      std::string m_dir;
+
+      /// @brief - The extension of the saved games files.
+      std::string m_ext;
+
+      /// @brief - The path to the persisted index.
+      std::string m_index;
+
+      /// @brief - Protects the entries and the flags used to
+      /// communicate with the scanning thread.
+      mutable std::mutex m_locker;
+
+      /// @brief - Used to wake up the scanning thread.
+      std::condition_variable m_notifier;
+
+      /// @brief - The saved games, sorted by name.
+      std::vector<SaveEntry> m_entries;
+
+      /// @brief - Incremented each time the entries change.
+      std::atomic<unsigned> m_revision;
+
+      /// @brief - Whether a scan was requested.
+      bool m_scanRequested;
+
+      /// @brief - Whether the scanning thread should stop.
+      bool m_stopRequested;
+
+      /// @brief - The scanning thread.
+      std::thread m_thread;
+  };
+
+}
+
+#endif    /* SAVE_CATALOGUE_HH */
@@ -1,10 +1,12 @@
 
 # include "SavedGames.hh"
 # include <filesystem>
+# include "SaveFile.hh"
 
 namespace {
 
-  pge::MenuShPtr
+  template <typename MenuType = pge::Menu>
+  std::shared_ptr<MenuType>
   generateGameEntry(const std::string& text,
                     const olc::Pixel& bgColor,
                     const olc::Pixel& textColor,
@@ -17,7 +19,7 @@ namespace {
     pge::menu::MenuContentDesc fd = pge::menu::newTextContent(text, textColor, pge::menu::Alignment::Center);
     fd.hColor = textHColor;
 
-    pge::MenuShPtr m = std::make_shared<pge::Menu>(
+    std::shared_ptr<MenuType> m = std::make_shared<MenuType>(
       olc::vi2d(),
       olc::vi2d(),
       name,
@@ -31,23 +33,36 @@ namespace {
     return m;
   }
 
+  std::string
+  describe(const pge::SaveEntry& entry) {
+    if (!entry.valid) {
+      return entry.name;
+    }
+
+    std::string out = entry.name + " (" + std::to_string(entry.variables) + " variable(s), " +
+                      std::to_string(entry.steps) + " step(s)";
+    if (!entry.legacy) {
+      out += ", " + eqdif::toString(entry.method);
+    }
+
+    return out + ")";
+  }
+
 }
 
 namespace pge {
 
-  // Convenience using to shorten the usage of the filesystem
-  // data types when loading the saved games list.
-  using DirIt = std::filesystem::directory_iterator;
-
   SavedGames::SavedGames(unsigned count,
                          const std::string& dir,
-                         const std::string& ext) noexcept:
+                         const std::string& ext):
     utils::CoreObject("games"),
 
     m_dir(dir),
     m_ext(ext),
 
-    m_saves(),
+    m_catalogue(dir, ext),
+    m_revision(m_catalogue.revision()),
+    m_names(),
     m_index(0u),
     m_gamesPerPage(count),
 
@@ -81,13 +96,13 @@ namespace pge {
 
     // Create menus for each line of the saved game screen.
     for (unsigned id = 0u ; id < m_gamesPerPage ; ++id) {
-      MenuShPtr m = generateGameEntry("", olc::DARK_CORNFLOWER_BLUE, olc::GREY, olc::BLACK, "game" + std::to_string(id));
+      PreviewMenuShPtr m = generateGameEntry<PreviewMenu>("", olc::DARK_CORNFLOWER_BLUE, olc::GREY, olc::BLACK, "game" + std::to_string(id));
       m->setSimpleAction(
-        [this, m](Game& /*g*/) {
+        [this, id](Game& /*g*/) {
           // Concatenate the save directory path to the name
           // of the game so that we can readily path it to
           // other processes.
-          std::string fullPath = m_dir + "/" + m->getText() + "." + m_ext;
+          std::string fullPath = m_dir + "/" + m_names[id] + "." + m_ext;
           onSavedGameSelected.safeEmit("saved game selected", fullPath);
         }
       );
@@ -103,7 +118,7 @@ namespace pge {
     m_next->setSimpleAction(
       [this](Game& /*g*/) {
         // Move to the next page if possible.
-        if (m_index + m_gamesPerPage < m_saves.size()) {
+        if (m_index + m_gamesPerPage < m_catalogue.size()) {
           m_index += m_gamesPerPage;
           update();
         }
@@ -121,58 +136,34 @@ namespace pge {
 
   void
   SavedGames::refresh() {
-    // Refresh the list of games that can be loaded by
-    // re-reading the content of the save directory.
-    // Note that we do not update the displayed values
-    // within this method.
-    DirIt end;
-    DirIt it(m_dir);
-
-    m_saves.clear();
-    m_existingFiles.clear();
-
-    debug("Scanning directory \"" + m_dir + "\" for saved games");
-
-    for (; it != end ; ++it) {
-      std::filesystem::directory_entry sg = *it;
-
-      // Only keep the base path in the display: the
-      // path to the save directory would just clutter
-      // the output.
-      std::string path = sg.path();
-      std::string name = path.substr(m_dir.size() + 1u);
-
-      // In any case, register this file.
-      m_existingFiles.insert(path);
-
-      // Also, only keep files matching the extension
-      // provided to this object.
-      std::size_t p = name.find_last_of('.');
-      if (p != std::string::npos) {
-        std::string ext = name.substr(p + 1u);
-        if (ext != m_ext) {
-          continue;
-        }
+    // The list of games is served from the catalogue: scanning
+    // the directory happens in the background and the display
+    // is updated once it completes.
+    m_catalogue.scan();
 
-        name = name.substr(0, p);
-      }
+    // Reset the index.
+    m_index = 0u;
+    m_revision = m_catalogue.revision();
 
-      if (name.empty()) {
-        warn("Failed to interpret saved game \"" + path + "\"");
-        continue;
-      }
+    // Update the display.
+    update();
+  }
 
-      m_saves.push_back(name);
+  void
+  SavedGames::synchronize() {
+    const unsigned revision = m_catalogue.revision();
+    if (revision == m_revision) {
+      return;
     }
 
-    // Sort the games in alphabetical order to ease
-    // finding a particular game.
-    std::sort(m_saves.begin(), m_saves.end());
+    m_revision = revision;
 
-    // Reset the index.
-    m_index = 0u;
+    // Stay on the current page if it still exists.
+    const std::size_t count = m_catalogue.size();
+    if (m_index >= count) {
+      m_index = (count > 0u ? (count - 1u) / m_gamesPerPage * m_gamesPerPage : 0u);
+    }
 
-    // Update the display.
     update();
   }
 
@@ -182,7 +173,8 @@ namespace pge {
     // exist yet in the directory.
     std::string out = m_dir + "/save_" + std::to_string(m_fileIndex) + "." + m_ext;
 
-    while (m_existingFiles.count(out) > 0) {
+    std::error_code code;
+    while (m_existingFiles.count(out) > 0 || std::filesystem::exists(out, code)) {
       ++m_fileIndex;
       out = m_dir + "/save_" + std::to_string(m_fileIndex) + "." + m_ext;
     }
@@ -197,12 +189,24 @@ namespace pge {
     // Update the text of the display menus with
     // the name of the games starting from the one
     // pointed at by the virtual cursor.
-    unsigned max = std::min(static_cast<unsigned>(m_saves.size()) - m_index, m_gamesPerPage);
+    const std::vector<SaveEntry> entries = m_catalogue.page(m_index, m_gamesPerPage);
+    m_names.resize(m_gamesPerPage);
 
     unsigned id = 0u;
-    for (; id < max ; ++id) {
-      m_games[id]->setText(m_saves[m_index + id]);
+    for (; id < entries.size() ; ++id) {
+      m_names[id] = entries[id].name;
+      m_games[id]->setText(describe(entries[id]));
       m_games[id]->setEnabled(true);
+
+      // Only the preview section of the save file is read.
+      eqdif::Preview preview;
+      const std::string path = m_dir + "/" + entries[id].name + "." + m_ext;
+      if (entries[id].valid && !entries[id].legacy && eqdif::readPreview(path, preview)) {
+        m_games[id]->setPreview(preview);
+      }
+      else {
+        m_games[id]->clearPreview();
+      }
     }
 
     // Fill the rest of the cells with blank spaces.
@@ -210,12 +214,13 @@ namespace pge {
       for (; id < m_gamesPerPage ; ++id) {
         m_games[id]->setText("");
         m_games[id]->setEnabled(false);
+        m_games[id]->clearPreview();
       }
     }
 
     // Update the next/previous page buttons.
     m_previous->setEnabled(m_index > 0u);
-    m_next->setEnabled(m_index + m_gamesPerPage < m_saves.size());
+    m_next->setEnabled(m_index + m_gamesPerPage < m_catalogue.size());
   }
 
 }
@@ -7,6 +7,8 @@
 # include <core_utils/CoreObject.hh>
 # include <core_utils/Signal.hh>
 # include "Menu.hh"
+# include "PreviewMenu.hh"
+# include "SaveCatalogue.hh"
 
 namespace pge {
 
@@ -15,14 +17,15 @@ namespace pge {
 
       /**
        * @brief - Creates a new class handling the save games with
-       *          the input properties.
+       *          the input properties. The catalogue of the saved
+       *          games starts scanning the directory right away.
        * @param count - the number of games to display.
        * @param dir - the name of the directory where games are stored.
        * @param ext - the extension of the files to consider.
        */
       SavedGames(unsigned count,
                  const std::string& dir,
-                 const std::string& ext) noexcept;
+                 const std::string& ext);
 
       /**
        * @brief - Generate the layout of this menu and attach all the
@@ -35,11 +38,21 @@ namespace pge {
       /**
        * @brief - Used to update the list of saved games. It is typically
        *          used in case the load game menu is being displayed to
-       *          ensure that we have up to date information in it.
+       *          ensure that we have up to date information in it. The
+       *          games known from the catalogue are displayed right away
+       *          while the directory is scanned in the background.
        */
       void
       refresh();
 
+      /**
+       * @brief - Update the displayed games in case the background
+       *          scan of the directory completed. This is meant to be
+       *          called regularly while the games are displayed.
+       */
+      void
+      synchronize();
+
       /**
        * @brief - Used to genertae a new name for a saved game in the
        *          directory which is not used yet.
@@ -78,10 +91,20 @@ namespace pge {
       std::string m_ext;
 
       /**
-       * @brief - The list of saved games as listed in the directory where
-       *          games are stored.
+       * @brief - The index of the saved games available in the directory
+       *          where games are stored.
+       */
+      SaveCatalogue m_catalogue;
+
+      /**
+       * @brief - The revision of the catalogue currently displayed.
+       */
+      unsigned m_revision;
+
+      /**
+       * @brief - The names of the saved games currently displayed.
        */
-      std::vector<std::string> m_saves;
+      std::vector<std::string> m_names;
 
       /**
        * @brief - The index of the first element displayed in the load game
@@ -97,9 +120,10 @@ namespace pge {
       unsigned m_gamesPerPage;
 
       /**
-       * @brief - The menus allowing to display the saved games names.
+       * @brief - The menus allowing to display the saved games names
+       *          along with the preview of their simulation.
        */
-      std::vector<MenuShPtr> m_games;
+      std::vector<PreviewMenuShPtr> m_games;
 
       /**
        * @brief - The menu representing the previous page option.
@@ -118,9 +142,9 @@ namespace pge {
       mutable unsigned m_fileIndex;
 
       /**
-       * @brief - The list of files currently available in the
-       *          directory. Allows to not overwrite any file
-       *          when generating a new name for a saved game.
+       * @brief - The list of names already generated for saved
+       *          games. Allows to not reuse a name while the game
+       *          is still being saved.
        */
       mutable Files m_existingFiles;
 
@@ -0,0 +1,182 @@
+
+# include "ChunkWorker.hh"
+# include <new>
+
+namespace {
+
+  /// @brief - The maximum number of operations in progress at once.
+  constexpr auto MAX_PENDING_WORK = 16u;
+
+}
+
+namespace eqdif {
+
+  std::shared_ptr<const EncodedChunk>
+  encodeChunk(const float* data,
+              unsigned steps,
+              unsigned variables,
+              const CompressionPolicy& policy)
+  {
+    auto encoded = std::make_shared<EncodedChunk>();
+    encoded->encoding = policy.encoding;
+    encoded->external = nullptr;
+
+    encoded->offsets.reserve(variables);
+    encoded->sizes.reserve(variables);
+
+    for (unsigned var = 0u ; var < variables ; ++var) {
+      encoded->offsets.push_back(encoded->bytes.size());
+      encodeColumn(data + var, steps, variables, policy, encoded->bytes);
+      encoded->sizes.push_back(encoded->bytes.size() - encoded->offsets.back());
+    }
+    encoded->bytes.shrink_to_fit();
+
+    return encoded;
+  }
+
+  ChunkWorker::ChunkWorker():
+    m_locker(),
+    m_notifier(),
+    m_tasks(MAX_PENDING_WORK),
+    m_taskHead(0u),
+    m_taskCount(0u),
+    m_results(MAX_PENDING_WORK),
+    m_resultHead(0u),
+    m_resultCount(0u),
+    m_outstanding(0u),
+    m_stopRequested(false),
+    m_thread()
+  {
+    m_thread = std::thread(&ChunkWorker::asynchronousWorkLoop, this);
+  }
+
+  ChunkWorker::~ChunkWorker() {
+    {
+      UniqueGuard guard(m_locker);
+      m_stopRequested = true;
+    }
+
+    m_notifier.notify_one();
+    m_thread.join();
+  }
+
+  bool
+  ChunkWorker::encode(std::size_t chunk,
+                      std::shared_ptr<float[]> storage,
+                      unsigned steps,
+                      unsigned variables,
+                      const CompressionPolicy& policy) noexcept
+  {
+    ChunkWork work{};
+    work.task = ChunkTask::Encode;
+    work.chunk = chunk;
+    work.steps = steps;
+    work.variables = variables;
+    work.policy = policy;
+    work.storage = std::move(storage);
+
+    return submit(std::move(work));
+  }
+
+  bool
+  ChunkWorker::allocate(std::size_t values) noexcept {
+    ChunkWork work{};
+    work.task = ChunkTask::Allocate;
+    work.values = values;
+
+    return submit(std::move(work));
+  }
+
+  bool
+  ChunkWorker::reserve(std::size_t values) noexcept {
+    ChunkWork work{};
+    work.task = ChunkTask::Reserve;
+    work.values = values;
+
+    return submit(std::move(work));
+  }
+
+  bool
+  ChunkWorker::collect(ChunkWork& work) noexcept {
+    UniqueGuard guard(m_locker);
+    if (m_resultCount == 0u) {
+      return false;
+    }
+
+    work = std::move(m_results[m_resultHead]);
+    m_resultHead = (m_resultHead + 1u) % m_results.size();
+    --m_resultCount;
+    --m_outstanding;
+
+    return true;
+  }
+
+  bool
+  ChunkWorker::submit(ChunkWork&& work) noexcept {
+    {
+      // The operations in progress and the completed ones are
+      // accounted for so that both ring buffers never overflow.
+      UniqueGuard guard(m_locker);
+      if (m_outstanding >= m_tasks.size()) {
+        return false;
+      }
+
+      m_tasks[(m_taskHead + m_taskCount) % m_tasks.size()] = std::move(work);
+      ++m_taskCount;
+      ++m_outstanding;
+    }
+
+    m_notifier.notify_one();
+
+    return true;
+  }
+
+  void
+  ChunkWorker::asynchronousWorkLoop() {
+    ChunkWork work{};
+
+    while (true) {
+      {
+        UniqueGuard guard(m_locker);
+        m_notifier.wait(
+          guard,
+          [this]() {
+            return m_stopRequested || m_taskCount > 0u;
+          }
+        );
+
+        if (m_stopRequested) {
+          return;
+        }
+
+        work = std::move(m_tasks[m_taskHead]);
+        m_taskHead = (m_taskHead + 1u) % m_tasks.size();
+        --m_taskCount;
+      }
+
+      // In case memory is exhausted the result is left empty: the
+      // trajectory then falls back to doing the work itself.
+      try {
+        switch (work.task) {
+          case ChunkTask::Encode:
+            work.encoded = encodeChunk(work.storage.get(), work.steps, work.variables, work.policy);
+            break;
+          case ChunkTask::Allocate:
+            work.storage.reset(new float[work.values]());
+            break;
+          case ChunkTask::Reserve:
+            work.buckets.reserve(work.values);
+            break;
+        }
+      }
+      catch (const std::bad_alloc&) {}
+
+      {
+        UniqueGuard guard(m_locker);
+        m_results[(m_resultHead + m_resultCount) % m_results.size()] = std::move(work);
+        ++m_resultCount;
+      }
+    }
+  }
+
+}
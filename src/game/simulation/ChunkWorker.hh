@@ -0,0 +1,197 @@
+#ifndef    CHUNK_WORKER_HH
+# define   CHUNK_WORKER_HH
+
+# include <mutex>
+# include <memory>
+# include <thread>
+# include <vector>
+# include <cstddef>
+# include <condition_variable>
+# include "Codec.hh"
+# include "Trajectory.hh"
+
+namespace eqdif {
+
+  /**
+   * @brief - Compress a chunk of steps column by column.
+   * @param data - the values of the steps of the chunk.
+   * @param steps - the number of steps in the chunk.
+   * @param variables - the number of variables in each step.
+   * @param policy - how to compress the values.
+   * @return - the compressed chunk.
+   */
+  std::shared_ptr<const EncodedChunk>
+  encodeChunk(const float* data,
+              unsigned steps,
+              unsigned variables,
+              const CompressionPolicy& policy);
+
+  /// @brief - The operations performed by a chunk worker.
+  enum class ChunkTask {
+    /// @brief - Compress a complete chunk.
+    Encode,
+    /// @brief - Allocate the storage of a new chunk.
+    Allocate,
+    /// @brief - Allocate the storage of a new decimated level.
+    Reserve
+  };
+
+  /// @brief - An operation performed by a chunk worker, holding both
+  /// its inputs and its result.
+  struct ChunkWork {
+    /// @brief - The operation to perform.
+    ChunkTask task;
+
+    /// @brief - For `Encode`, the absolute index of the chunk in the
+    /// trajectory.
+    std::size_t chunk;
+
+    /// @brief - For `Encode`, the number of steps in the chunk and of
+    /// variables in each step.
+    unsigned steps;
+    unsigned variables;
+
+    /// @brief - For `Encode`, how to compress the chunk.
+    CompressionPolicy policy;
+
+    /// @brief - For `Allocate` and `Reserve`, the number of values to
+    /// allocate.
+    std::size_t values;
+
+    /// @brief - The values of the chunk to compress for `Encode`, and
+    /// the allocated chunk for `Allocate`.
+    std::shared_ptr<float[]> storage;
+
+    /// @brief - For `Encode`, the compressed chunk.
+    std::shared_ptr<const EncodedChunk> encoded;
+
+    /// @brief - For `Reserve`, the storage of the decimated level.
+    std::vector<float> buckets;
+  };
+
+  /// @brief - Prepares the memory of a trajectory in the background
+  /// so that the simulation thread does not allocate when it adds
+  /// steps: the chunks which are no longer recent are compressed,
+  /// and the storage of the next chunks and decimated levels is
+  /// allocated ahead of time.
+  ///
+  /// The worker never accesses the trajectory: the operations are
+  /// submitted with all their inputs and the trajectory collects the
+  /// results when it is convenient. Only a bounded number of them can
+  /// be in progress at once, so that neither submitting nor collecting
+  /// allocates memory.
+  class ChunkWorker {
+    public:
+
+      /**
+       * @brief - Start the worker thread.
+       */
+      ChunkWorker();
+
+      /**
+       * @brief - Stop the worker thread. The operations which are not
+       *          collected yet are discarded.
+       */
+      ~ChunkWorker();
+
+      /**
+       * @brief - Request a complete chunk to be compressed. The chunk
+       *          should not be modified until the result is collected.
+       * @param chunk - the absolute index of the chunk.
+       * @param storage - the values of the chunk, kept alive until the
+       *                  result is collected.
+       * @param steps - the number of steps in the chunk.
+       * @param variables - the number of variables in each step.
+       * @param policy - how to compress the chunk.
+       * @return - `false` if too many operations are in progress, in
+       *           which case nothing is done.
+       */
+      bool
+      encode(std::size_t chunk,
+             std::shared_ptr<float[]> storage,
+             unsigned steps,
+             unsigned variables,
+             const CompressionPolicy& policy) noexcept;
+
+      /**
+       * @brief - Request the storage of a new chunk.
+       * @param values - the number of values in the chunk.
+       * @return - `false` if too many operations are in progress, in
+       *           which case nothing is done.
+       */
+      bool
+      allocate(std::size_t values) noexcept;
+
+      /**
+       * @brief - Request the storage of a new decimated level.
+       * @param values - the number of values the level can hold.
+       * @return - `false` if too many operations are in progress, in
+       *           which case nothing is done.
+       */
+      bool
+      reserve(std::size_t values) noexcept;
+
+      /**
+       * @brief - Retrieve the result of a completed operation, in the
+       *          order in which they complete.
+       * @param work - output argument receiving the operation.
+       * @return - `false` if no operation is completed.
+       */
+      bool
+      collect(ChunkWork& work) noexcept;
+
+    private:
+
+      /**
+       * @brief - Add an operation to the ones to perform.
+       * @param work - the operation.
+       * @return - `false` if too many operations are in progress.
+       */
+      bool
+      submit(ChunkWork&& work) noexcept;
+
+      /**
+       * @brief - Executed by the worker thread: wait for operations to
+       *          be submitted and perform them.
+       */
+      void
+      asynchronousWorkLoop();
+
+    private:
+
+      /// @brief - Convenience define for a unique lock.
+      using UniqueGuard = std::unique_lock<std::mutex>;
+
+      /// @brief - Protects the queues of operations.
+      std::mutex m_locker;
+
+      /// @brief - Used to wake up the worker thread when operations
+      /// are submitted or when it should stop.
+      std::condition_variable m_notifier;
+
+      /// @brief - The operations waiting to be performed, as a ring
+      /// buffer starting at `m_taskHead`.
+      std::vector<ChunkWork> m_tasks;
+      unsigned m_taskHead;
+      unsigned m_taskCount;
+
+      /// @brief - The completed operations, as a ring buffer starting
+      /// at `m_resultHead`.
+      std::vector<ChunkWork> m_results;
+      unsigned m_resultHead;
+      unsigned m_resultCount;
+
+      /// @brief - The number of operations submitted and not collected
+      /// yet, bounded by the size of the ring buffers.
+      unsigned m_outstanding;
+
+      /// @brief - Whether the worker thread should stop.
+      bool m_stopRequested;
+
+      /// @brief - The worker thread.
+      std::thread m_thread;
+  };
+
+}
+
+#endif    /* CHUNK_WORKER_HH */
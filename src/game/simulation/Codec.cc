@@ -0,0 +1,453 @@
+
+# include "Codec.hh"
+# include <cstring>
+# include <algorithm>
+
+namespace eqdif {
+
+  namespace {
+
+    /// @brief - The number of bits in the mantissa of a float.
+    constexpr auto MANTISSA_BITS = 23u;
+
+    /// @brief - Accumulates bits and appends them to a buffer of
+    /// bytes, most significant bits first.
+    class BitWriter {
+      public:
+
+        explicit
+        BitWriter(std::vector<std::uint8_t>& out) noexcept:
+          m_out(out),
+          m_buffer(0u),
+          m_bits(0u)
+        {}
+
+        void
+        write(std::uint32_t value, unsigned bits) {
+          // Bits are accumulated in a 64 bits buffer which always has
+          // room for 32 more bits when less than 32 are pending.
+          m_buffer = (m_buffer << bits) | (bits < 32u ? value & ((1u << bits) - 1u) : value);
+          m_bits += bits;
+
+          while (m_bits >= 8u) {
+            m_bits -= 8u;
+            m_out.push_back(static_cast<std::uint8_t>(m_buffer >> m_bits));
+          }
+        }
+
+        void
+        finish() {
+          if (m_bits > 0u) {
+            m_out.push_back(static_cast<std::uint8_t>(m_buffer << (8u - m_bits)));
+            m_bits = 0u;
+          }
+        }
+
+      private:
+
+        std::vector<std::uint8_t>& m_out;
+        std::uint64_t m_buffer;
+        unsigned m_bits;
+    };
+
+    /// @brief - Reads bits written by a `BitWriter`.
+    class BitReader {
+      public:
+
+        BitReader(const std::uint8_t* data, std::size_t size) noexcept:
+          m_data(data),
+          m_size(size),
+          m_offset(0u),
+          m_buffer(0u),
+          m_bits(0u)
+        {}
+
+        bool
+        read(unsigned bits, std::uint32_t& value) noexcept {
+          while (m_bits < bits) {
+            if (m_offset >= m_size) {
+              return false;
+            }
+
+            m_buffer = (m_buffer << 8u) | m_data[m_offset];
+            ++m_offset;
+            m_bits += 8u;
+          }
+
+          m_bits -= bits;
+          value = static_cast<std::uint32_t>(m_buffer >> m_bits);
+          if (bits < 32u) {
+            value &= (1u << bits) - 1u;
+          }
+
+          return true;
+        }
+
+      private:
+
+        const std::uint8_t* m_data;
+        std::size_t m_size;
+        std::size_t m_offset;
+        std::uint64_t m_buffer;
+        unsigned m_bits;
+    };
+
+    std::uint32_t
+    toBits(float value) noexcept {
+      std::uint32_t bits;
+      std::memcpy(&bits, &value, sizeof(float));
+      return bits;
+    }
+
+    float
+    fromBits(std::uint32_t bits) noexcept {
+      float value;
+      std::memcpy(&value, &bits, sizeof(float));
+      return value;
+    }
+
+    /// @brief - Convert the bits of a float to an integer which is
+    /// ordered like the floats: the sign and magnitude representation
+    /// is converted to a one's complement one. The discarded bits of
+    /// the mantissa are removed from the magnitude.
+    std::int64_t
+    toOrdered(std::uint32_t bits, unsigned discarded) noexcept {
+      const std::int64_t magnitude = (bits & 0x7fffffffu) >> discarded;
+      return ((bits & 0x80000000u) != 0u ? -magnitude - 1 : magnitude);
+    }
+
+    std::uint32_t
+    fromOrdered(std::int64_t ordered, unsigned discarded) noexcept {
+      if (ordered < 0) {
+        return 0x80000000u | (static_cast<std::uint32_t>(-ordered - 1) << discarded);
+      }
+
+      return static_cast<std::uint32_t>(ordered) << discarded;
+    }
+
+    /// @brief - The number of bits used to store a change of delta
+    /// for each prefix: a prefix of `n` bits set to `1` followed by
+    /// a `0` selects the `n-th` size, except for the last one which
+    /// has no trailing `0`.
+    constexpr unsigned DELTA_SIZES[] = {0u, 6u, 9u, 13u, 20u, 34u};
+    constexpr auto DELTA_SIZES_COUNT = sizeof(DELTA_SIZES) / sizeof(DELTA_SIZES[0]);
+
+    void
+    encodeXor(const float* values,
+              std::size_t count,
+              std::size_t stride,
+              std::uint32_t mask,
+              BitWriter& writer)
+    {
+      std::uint32_t previous = 0u;
+      unsigned leading = 32u, trailing = 32u;
+
+      for (std::size_t id = 0u ; id < count ; ++id) {
+        const std::uint32_t bits = toBits(values[id * stride]) & mask;
+
+        if (id == 0u) {
+          writer.write(bits, 32u);
+          previous = bits;
+          continue;
+        }
+
+        // A single bit is enough when the value does not change.
+        const std::uint32_t x = bits ^ previous;
+        previous = bits;
+
+        if (x == 0u) {
+          writer.write(0u, 1u);
+          continue;
+        }
+
+        writer.write(1u, 1u);
+
+        // Store the meaningful bits of the XOR, reusing the previous
+        // window when it contains all of them.
+        const unsigned lz = std::min(static_cast<unsigned>(__builtin_clz(x)), 31u);
+        const unsigned tz = static_cast<unsigned>(__builtin_ctz(x));
+
+        if (leading + trailing < 32u && lz >= leading && tz >= trailing) {
+          writer.write(0u, 1u);
+          writer.write(x >> trailing, 32u - leading - trailing);
+          continue;
+        }
+
+        leading = lz;
+        trailing = tz;
+        const unsigned meaningful = 32u - leading - trailing;
+
+        writer.write(1u, 1u);
+        writer.write(leading, 5u);
+        writer.write(meaningful - 1u, 5u);
+        writer.write(x >> trailing, meaningful);
+      }
+    }
+
+    bool
+    decodeXor(BitReader& reader,
+              std::size_t count,
+              std::size_t stride,
+              float* out) noexcept
+    {
+      std::uint32_t previous = 0u;
+      unsigned leading = 32u, trailing = 32u;
+
+      for (std::size_t id = 0u ; id < count ; ++id) {
+        std::uint32_t flag = 0u;
+
+        if (id == 0u) {
+          if (!reader.read(32u, previous)) {
+            return false;
+          }
+        }
+        else {
+          if (!reader.read(1u, flag)) {
+            return false;
+          }
+
+          if (flag != 0u) {
+            if (!reader.read(1u, flag)) {
+              return false;
+            }
+
+            // A new window is defined for the meaningful bits.
+            if (flag != 0u) {
+              std::uint32_t lz = 0u, meaningful = 0u;
+              if (!reader.read(5u, lz) || !reader.read(5u, meaningful)) {
+                return false;
+              }
+
+              if (lz + meaningful + 1u > 32u) {
+                return false;
+              }
+
+              leading = lz;
+              trailing = 32u - leading - (meaningful + 1u);
+            }
+
+            std::uint32_t x = 0u;
+            if (leading + trailing >= 32u || !reader.read(32u - leading - trailing, x)) {
+              return false;
+            }
+
+            previous ^= (x << trailing);
+          }
+        }
+
+        out[id * stride] = fromBits(previous);
+      }
+
+      return true;
+    }
+
+    void
+    encodeDelta(const float* values,
+                std::size_t count,
+                std::size_t stride,
+                unsigned discarded,
+                BitWriter& writer)
+    {
+      // Discarded bits are removed from the integers so that the
+      // deltas are smaller.
+      writer.write(discarded, 5u);
+
+      std::int64_t previous = 0, delta = 0;
+
+      for (std::size_t id = 0u ; id < count ; ++id) {
+        const std::int64_t ordered = toOrdered(toBits(values[id * stride]), discarded);
+
+        if (id == 0u) {
+          writer.write(static_cast<std::uint32_t>(static_cast<std::int32_t>(ordered)), 32u);
+          previous = ordered;
+          continue;
+        }
+
+        const std::int64_t d = ordered - previous;
+        const std::int64_t dd = d - delta;
+        previous = ordered;
+        delta = d;
+
+        // Zigzag encoding so that small negative changes also lead
+        // to small values.
+        const std::uint64_t z = (dd < 0 ? (static_cast<std::uint64_t>(-dd) << 1u) - 1u : static_cast<std::uint64_t>(dd) << 1u);
+
+        unsigned size = 0u;
+        while (size + 1u < DELTA_SIZES_COUNT && z >= (std::uint64_t{1} << DELTA_SIZES[size])) {
+          writer.write(1u, 1u);
+          ++size;
+        }
+        if (size + 1u < DELTA_SIZES_COUNT) {
+          writer.write(0u, 1u);
+        }
+
+        const unsigned bits = DELTA_SIZES[size];
+        if (bits > 32u) {
+          writer.write(static_cast<std::uint32_t>(z >> 32u), bits - 32u);
+          writer.write(static_cast<std::uint32_t>(z), 32u);
+        }
+        else if (bits > 0u) {
+          writer.write(static_cast<std::uint32_t>(z), bits);
+        }
+      }
+    }
+
+    bool
+    decodeDelta(BitReader& reader,
+                std::size_t count,
+                std::size_t stride,
+                float* out) noexcept
+    {
+      std::uint32_t discarded = 0u, first = 0u;
+      if (!reader.read(5u, discarded)) {
+        return false;
+      }
+
+      std::int64_t previous = 0, delta = 0;
+
+      for (std::size_t id = 0u ; id < count ; ++id) {
+        if (id == 0u) {
+          if (!reader.read(32u, first)) {
+            return false;
+          }
+
+          previous = static_cast<std::int32_t>(first);
+        }
+        else {
+          unsigned size = 0u;
+          std::uint32_t flag = 1u;
+          while (size + 1u < DELTA_SIZES_COUNT) {
+            if (!reader.read(1u, flag)) {
+              return false;
+            }
+            if (flag == 0u) {
+              break;
+            }
+            ++size;
+          }
+
+          std::uint64_t z = 0u;
+          std::uint32_t part = 0u;
+          const unsigned bits = DELTA_SIZES[size];
+
+          if (bits > 32u) {
+            if (!reader.read(bits - 32u, part)) {
+              return false;
+            }
+            z = static_cast<std::uint64_t>(part) << 32u;
+            if (!reader.read(32u, part)) {
+              return false;
+            }
+            z |= part;
+          }
+          else if (bits > 0u) {
+            if (!reader.read(bits, part)) {
+              return false;
+            }
+            z = part;
+          }
+
+          const std::int64_t dd = ((z & 1u) != 0u ? -static_cast<std::int64_t>((z + 1u) >> 1u) : static_cast<std::int64_t>(z >> 1u));
+          delta += dd;
+          previous += delta;
+        }
+
+        out[id * stride] = fromBits(fromOrdered(previous, discarded));
+      }
+
+      return true;
+    }
+
+  }
+
+  std::string
+  toString(const Encoding& encoding) noexcept {
+    switch (encoding) {
+      case Encoding::Raw:
+        return "raw";
+      case Encoding::Xor:
+        return "xor";
+      case Encoding::Delta:
+        return "delta";
+      default:
+        return "unknown";
+    }
+  }
+
+  CompressionPolicy
+  noCompression() noexcept {
+    return CompressionPolicy{
+      Encoding::Raw, // encoding
+      MANTISSA_BITS  // mantissaBits
+    };
+  }
+
+  CompressionPolicy
+  losslessCompression(const Encoding& encoding) noexcept {
+    return CompressionPolicy{
+      encoding,     // encoding
+      MANTISSA_BITS // mantissaBits
+    };
+  }
+
+  void
+  encodeColumn(const float* values,
+               std::size_t count,
+               std::size_t stride,
+               const CompressionPolicy& policy,
+               std::vector<std::uint8_t>& out)
+  {
+    // Discarding bits of the mantissa is done by clearing them.
+    const unsigned discarded = MANTISSA_BITS - std::min(policy.mantissaBits, MANTISSA_BITS);
+
+    BitWriter writer(out);
+
+    switch (policy.encoding) {
+      case Encoding::Xor:
+        encodeXor(values, count, stride, ~0u << discarded, writer);
+        break;
+      case Encoding::Delta:
+        encodeDelta(values, count, stride, discarded, writer);
+        break;
+      case Encoding::Raw:
+      default:
+        for (std::size_t id = 0u ; id < count ; ++id) {
+          writer.write(toBits(values[id * stride]), 32u);
+        }
+        break;
+    }
+
+    writer.finish();
+  }
+
+  bool
+  decodeColumn(const std::uint8_t* data,
+               std::size_t size,
+               const Encoding& encoding,
+               std::size_t count,
+               std::size_t stride,
+               float* out) noexcept
+  {
+    BitReader reader(data, size);
+
+    switch (encoding) {
+      case Encoding::Raw:
+        for (std::size_t id = 0u ; id < count ; ++id) {
+          std::uint32_t bits = 0u;
+          if (!reader.read(32u, bits)) {
+            return false;
+          }
+
+          out[id * stride] = fromBits(bits);
+        }
+        return true;
+      case Encoding::Xor:
+        return decodeXor(reader, count, stride, out);
+      case Encoding::Delta:
+        return decodeDelta(reader, count, stride, out);
+      default:
+        return false;
+    }
+  }
+
+}
@@ -0,0 +1,106 @@
+#ifndef    CODEC_HH
+# define   CODEC_HH
+
+# include <string>
+# include <vector>
+# include <cstdint>
+# include <cstddef>
+
+namespace eqdif {
+
+  /// @brief - The possible encodings for the values of a variable
+  /// over consecutive steps.
+  enum class Encoding: std::uint32_t {
+    /// @brief - Values are stored as is.
+    Raw,
+    /// @brief - Each value is stored as the XOR with the previous
+    /// one (see http://www.vldb.org/pvldb/vol8/p1816-teller.pdf):
+    /// as consecutive values are close, the XOR has many leading and
+    /// trailing zeros which don't need to be stored.
+    Xor,
+    /// @brief - Values are interpreted as integers with the same
+    /// ordering and each one is stored as the change of its delta
+    /// with the previous one. The variables of a smooth trajectory
+    /// change at a slowly varying rate so most values only need a
+    /// few bits.
+    Delta
+  };
+
+  /**
+   * @brief - Convert an encoding to a human readable string.
+   * @param encoding - the encoding to convert.
+   * @return - the corresponding string.
+   */
+  std::string
+  toString(const Encoding& encoding) noexcept;
+
+  /// @brief - Defines how values are compressed.
+  struct CompressionPolicy {
+    /// @brief - The encoding to use.
+    Encoding encoding;
+
+    /// @brief - The number of bits of the mantissa which are kept
+    /// for each value, between `0` and `23`. When less than `23` the
+    /// lowest bits are discarded before encoding so the compression
+    /// is lossy: the relative error on each value is at most equal
+    /// to `2^-mantissaBits`. Ignored for the `Raw` encoding.
+    unsigned mantissaBits;
+  };
+
+  /**
+   * @brief - Generate a compression policy storing values as is.
+   * @return - the compression policy.
+   */
+  CompressionPolicy
+  noCompression() noexcept;
+
+  /**
+   * @brief - Generate a compression policy which does not lose any
+   *          precision with the input encoding.
+   * @param encoding - the encoding to use.
+   * @return - the compression policy.
+   */
+  CompressionPolicy
+  losslessCompression(const Encoding& encoding) noexcept;
+
+  /**
+   * @brief - Encode a column of values and append the result to the
+   *          output buffer.
+   * @param values - the first value to encode.
+   * @param count - the number of values to encode.
+   * @param stride - the distance between two consecutive values in
+   *                 the input array, as a number of floats.
+   * @param policy - how to encode the values.
+   * @param out - output buffer to which encoded bytes are appended.
+   */
+  void
+  encodeColumn(const float* values,
+               std::size_t count,
+               std::size_t stride,
+               const CompressionPolicy& policy,
+               std::vector<std::uint8_t>& out);
+
+  /**
+   * @brief - Decode a column of values encoded with `encodeColumn`.
+   *          The quantization of the values does not need to be
+   *          known.
+   * @param data - the encoded bytes.
+   * @param size - the number of encoded bytes.
+   * @param encoding - the encoding used for the values.
+   * @param count - the number of values to decode.
+   * @param stride - the distance between two consecutive values in
+   *                 the output array, as a number of floats.
+   * @param out - output array for the decoded values.
+   * @return - `false` if the data is truncated.
+   */
+  bool
+  decodeColumn(const std::uint8_t* data,
+               std::size_t size,
+               const Encoding& encoding,
+               std::size_t count,
+               std::size_t stride,
+               float* out) noexcept;
+
+}
+
+#endif    /* CODEC_HH */
@@ -0,0 +1,363 @@
+
+# include "CompiledSystem.hh"
+# include <cmath>
+# include <map>
+# include <algorithm>
+
+namespace {
+
+  /// @brief - The canonical form of a monomial, used as a key to
+  /// intern them: a sorted list of variable index and exponent.
+  using MonomialKey = std::vector<std::pair<unsigned, float>>;
+
+  /// @brief - The largest integer exponent which is evaluated
+  /// through repeated multiplications rather than `std::pow`.
+  constexpr auto MAXIMUM_INTEGER_EXPONENT = 16;
+
+  inline
+  float
+  integerPower(float x, int n) noexcept {
+    // https://en.wikipedia.org/wiki/Exponentiation_by_squaring
+    const bool negative = (n < 0);
+    unsigned e = static_cast<unsigned>(negative ? -n : n);
+
+    float out = 1.0f;
+    while (e > 0u) {
+      if (e & 1u) {
+        out *= x;
+      }
+      x *= x;
+      e >>= 1u;
+    }
+
+    return negative ? 1.0f / out : out;
+  }
+
+  inline
+  float
+  power(float x, float n, const eqdif::ExponentKind& kind) noexcept {
+    switch (kind) {
+      case eqdif::ExponentKind::Zero:
+        return 1.0f;
+      case eqdif::ExponentKind::Linear:
+        return x;
+      case eqdif::ExponentKind::Square:
+        return x * x;
+      case eqdif::ExponentKind::Cube:
+        return x * x * x;
+      case eqdif::ExponentKind::SquareRoot:
+        return std::sqrt(x);
+      case eqdif::ExponentKind::Inverse:
+        return 1.0f / x;
+      case eqdif::ExponentKind::Integer:
+        return integerPower(x, static_cast<int>(n));
+      case eqdif::ExponentKind::Generic:
+      default:
+        return std::pow(x, n);
+    }
+  }
+
+  inline
+  float
+  powerDerivative(float x, float n, const eqdif::ExponentKind& kind) noexcept {
+    // https://en.wikipedia.org/wiki/Power_rule
+    switch (kind) {
+      case eqdif::ExponentKind::Zero:
+        return 0.0f;
+      case eqdif::ExponentKind::Linear:
+        return 1.0f;
+      case eqdif::ExponentKind::Square:
+        return 2.0f * x;
+      case eqdif::ExponentKind::Cube:
+        return 3.0f * x * x;
+      case eqdif::ExponentKind::SquareRoot:
+        return 0.5f / std::sqrt(x);
+      case eqdif::ExponentKind::Inverse:
+        return -1.0f / (x * x);
+      case eqdif::ExponentKind::Integer:
+        return n * integerPower(x, static_cast<int>(n) - 1);
+      case eqdif::ExponentKind::Generic:
+      default:
+        return n * std::pow(x, n - 1.0f);
+    }
+  }
+
+}
+
+namespace eqdif {
+
+  ExponentKind
+  classifyExponent(float n) noexcept {
+    if (n == 0.0f) {
+      return ExponentKind::Zero;
+    }
+    if (n == 1.0f) {
+      return ExponentKind::Linear;
+    }
+    if (n == 2.0f) {
+      return ExponentKind::Square;
+    }
+    if (n == 3.0f) {
+      return ExponentKind::Cube;
+    }
+    if (n == 0.5f) {
+      return ExponentKind::SquareRoot;
+    }
+    if (n == -1.0f) {
+      return ExponentKind::Inverse;
+    }
+
+    if (std::trunc(n) == n && std::abs(n) <= MAXIMUM_INTEGER_EXPONENT) {
+      return ExponentKind::Integer;
+    }
+
+    return ExponentKind::Generic;
+  }
+
+  CompiledSystem::CompiledSystem(const System& system):
+    m_equationOffsets(),
+    m_orders(),
+    m_coefficients(),
+    m_termMonomials(),
+    m_monomialOffsets(),
+    m_ids(),
+    m_exponents(),
+    m_kinds(),
+    m_monomialValues(),
+
+    m_jacobianOffsets(),
+    m_jacobianColumns(),
+    m_contributionOffsets(),
+    m_contributionCoefficients(),
+    m_contributionDependencies(),
+    m_factors(),
+    m_partials()
+  {
+    std::map<MonomialKey, unsigned> interned;
+
+    m_equationOffsets.push_back(0u);
+    m_monomialOffsets.push_back(0u);
+
+    for (unsigned eqId = 0u ; eqId < system.size() ; ++eqId) {
+      const Equation& eq = system[eqId];
+      const unsigned first = m_coefficients.size();
+
+      m_orders.push_back(static_cast<unsigned>(std::max(eq.order, 1)));
+
+      for (unsigned coeff = 0u ; coeff < eq.coeffs.size() ; ++coeff) {
+        const SingleCoefficient& sf = eq.coeffs[coeff];
+
+        // Build the canonical form of the monomial: the order of
+        // the dependencies does not matter.
+        MonomialKey key;
+        for (unsigned dep = 0u ; dep < sf.dependencies.size() ; ++dep) {
+          key.push_back({sf.dependencies[dep].id, sf.dependencies[dep].n});
+        }
+        std::sort(key.begin(), key.end());
+
+        auto it = interned.find(key);
+        if (it == interned.end()) {
+          for (unsigned dep = 0u ; dep < key.size() ; ++dep) {
+            m_ids.push_back(key[dep].first);
+            m_exponents.push_back(key[dep].second);
+            m_kinds.push_back(classifyExponent(key[dep].second));
+          }
+
+          m_monomialOffsets.push_back(m_ids.size());
+          it = interned.emplace(key, m_monomialOffsets.size() - 2u).first;
+        }
+
+        // Terms of the same equation sharing a monomial can be
+        // merged into a single one.
+        unsigned term = first;
+        while (term < m_termMonomials.size() && m_termMonomials[term] != it->second) {
+          ++term;
+        }
+
+        if (term < m_termMonomials.size()) {
+          m_coefficients[term] += sf.value;
+        }
+        else {
+          m_coefficients.push_back(sf.value);
+          m_termMonomials.push_back(it->second);
+        }
+      }
+
+      m_equationOffsets.push_back(m_coefficients.size());
+    }
+
+    m_monomialValues.resize(monomials(), 0.0f);
+
+    compileJacobian();
+  }
+
+  unsigned
+  CompiledSystem::size() const noexcept {
+    return m_equationOffsets.empty() ? 0u : m_equationOffsets.size() - 1u;
+  }
+
+  unsigned
+  CompiledSystem::order(unsigned eq) const noexcept {
+    return m_orders[eq];
+  }
+
+  unsigned
+  CompiledSystem::maxOrder() const noexcept {
+    return m_orders.empty() ? 1u : *std::max_element(m_orders.begin(), m_orders.end());
+  }
+
+  unsigned
+  CompiledSystem::terms() const noexcept {
+    return m_coefficients.size();
+  }
+
+  unsigned
+  CompiledSystem::monomials() const noexcept {
+    return m_monomialOffsets.empty() ? 0u : m_monomialOffsets.size() - 1u;
+  }
+
+  float
+  CompiledSystem::derivative(unsigned eq, const float* values) const noexcept {
+    float derivative = 0.0f;
+
+    const unsigned end = m_equationOffsets[eq + 1u];
+    for (unsigned term = m_equationOffsets[eq] ; term < end ; ++term) {
+      derivative += m_coefficients[term] * monomial(m_termMonomials[term], values);
+    }
+
+    return derivative;
+  }
+
+  void
+  CompiledSystem::evaluate(const float* values, float* derivatives) const noexcept {
+    // Compute each distinct monomial once.
+    const unsigned count = monomials();
+    for (unsigned m = 0u ; m < count ; ++m) {
+      m_monomialValues[m] = monomial(m, values);
+    }
+
+    // Accumulate the terms of each equation.
+    const unsigned eqs = size();
+    for (unsigned eq = 0u ; eq < eqs ; ++eq) {
+      float derivative = 0.0f;
+
+      const unsigned end = m_equationOffsets[eq + 1u];
+      for (unsigned term = m_equationOffsets[eq] ; term < end ; ++term) {
+        derivative += m_coefficients[term] * m_monomialValues[m_termMonomials[term]];
+      }
+
+      derivatives[eq] = derivative;
+    }
+  }
+
+  unsigned
+  CompiledSystem::jacobianEntries() const noexcept {
+    return m_jacobianColumns.size();
+  }
+
+  const std::vector<unsigned>&
+  CompiledSystem::jacobianOffsets() const noexcept {
+    return m_jacobianOffsets;
+  }
+
+  const std::vector<unsigned>&
+  CompiledSystem::jacobianColumns() const noexcept {
+    return m_jacobianColumns;
+  }
+
+  void
+  CompiledSystem::jacobian(const float* values, float* entries) const noexcept {
+    // Compute the partial derivatives of each distinct monomial with
+    // regard to each of its dependencies. The derivative of a factor
+    // is multiplied by the product of the other ones, which is built
+    // from a forward and a backward pass: this does not divide by the
+    // factors which may be zero.
+    const unsigned count = monomials();
+    for (unsigned m = 0u ; m < count ; ++m) {
+      const unsigned start = m_monomialOffsets[m];
+      const unsigned end = m_monomialOffsets[m + 1u];
+
+      float prefix = 1.0f;
+      for (unsigned dep = start ; dep < end ; ++dep) {
+        m_factors[dep] = power(values[m_ids[dep]], m_exponents[dep], m_kinds[dep]);
+        m_partials[dep] = prefix;
+        prefix *= m_factors[dep];
+      }
+
+      float suffix = 1.0f;
+      for (unsigned dep = end ; dep > start ; --dep) {
+        const unsigned id = dep - 1u;
+        m_partials[id] *= suffix * powerDerivative(values[m_ids[id]], m_exponents[id], m_kinds[id]);
+        suffix *= m_factors[id];
+      }
+    }
+
+    // Accumulate the contributions to each entry.
+    const unsigned total = jacobianEntries();
+    for (unsigned entry = 0u ; entry < total ; ++entry) {
+      float value = 0.0f;
+
+      const unsigned end = m_contributionOffsets[entry + 1u];
+      for (unsigned c = m_contributionOffsets[entry] ; c < end ; ++c) {
+        value += m_contributionCoefficients[c] * m_partials[m_contributionDependencies[c]];
+      }
+
+      entries[entry] = value;
+    }
+  }
+
+  void
+  CompiledSystem::compileJacobian() {
+    // Each dependency of the monomial of a term contributes to the
+    // entry of the row of the equation and the column of the variable
+    // of the dependency. A variable may appear several times in the
+    // same monomial, in which case it contributes several times.
+    m_jacobianOffsets.push_back(0u);
+    m_contributionOffsets.push_back(0u);
+
+    const unsigned eqs = size();
+    for (unsigned eq = 0u ; eq < eqs ; ++eq) {
+      std::map<unsigned, std::vector<std::pair<float, unsigned>>> row;
+
+      const unsigned end = m_equationOffsets[eq + 1u];
+      for (unsigned term = m_equationOffsets[eq] ; term < end ; ++term) {
+        const unsigned m = m_termMonomials[term];
+
+        for (unsigned dep = m_monomialOffsets[m] ; dep < m_monomialOffsets[m + 1u] ; ++dep) {
+          if (m_kinds[dep] != ExponentKind::Zero) {
+            row[m_ids[dep]].push_back({m_coefficients[term], dep});
+          }
+        }
+      }
+
+      for (const auto& [column, contributions] : row) {
+        m_jacobianColumns.push_back(column);
+
+        for (const auto& [coefficient, dep] : contributions) {
+          m_contributionCoefficients.push_back(coefficient);
+          m_contributionDependencies.push_back(dep);
+        }
+
+        m_contributionOffsets.push_back(m_contributionCoefficients.size());
+      }
+
+      m_jacobianOffsets.push_back(m_jacobianColumns.size());
+    }
+
+    m_factors.resize(m_ids.size(), 0.0f);
+    m_partials.resize(m_ids.size(), 0.0f);
+  }
+
+  float
+  CompiledSystem::monomial(unsigned monomial, const float* values) const noexcept {
+    float out = 1.0f;
+
+    const unsigned end = m_monomialOffsets[monomial + 1u];
+    for (unsigned dep = m_monomialOffsets[monomial] ; dep < end ; ++dep) {
+      out *= power(values[m_ids[dep]], m_exponents[dep], m_kinds[dep]);
+    }
+
+    return out;
+  }
+
+}
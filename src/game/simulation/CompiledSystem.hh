@@ -0,0 +1,254 @@
+#ifndef    COMPILED_SYSTEM_HH
+# define   COMPILED_SYSTEM_HH
+
+# include <vector>
+# include "System.hh"
+
+namespace eqdif {
+
+  /// @brief - The kind of an exponent of a dependency. Most of the
+  /// exponents are either `1` or small integers: rather than using
+  /// the general `std::pow` function for all of them we classify
+  /// them when the system is compiled and use specialized kernels.
+  enum class ExponentKind {
+    Zero,
+    Linear,
+    Square,
+    Cube,
+    SquareRoot,
+    Inverse,
+    Integer,
+    Generic
+  };
+
+  /**
+   * @brief - Determine the kind of the input exponent.
+   * @param n - the exponent to classify.
+   * @return - the kind of exponent.
+   */
+  ExponentKind
+  classifyExponent(float n) noexcept;
+
+  /// @brief - A flattened representation of a `System` which is
+  /// meant to be built once when the model is loaded and then used
+  /// to evaluate the derivatives of all variables. The nested list
+  /// of equations, coefficients and dependencies is converted into
+  /// a set of contiguous arrays in a CSR-like fashion.
+  ///
+  /// The products of dependencies (the monomials such as `x * y`)
+  /// are interned in a shared table: each distinct monomial is only
+  /// computed once per evaluation even if it appears in several of
+  /// the equations. The layout is thus:
+  ///  - the dependencies of monomial `m` are in the range given by
+  ///    the offsets `m` and `m + 1` of `m_monomialOffsets`.
+  ///  - the terms of equation `i` are in the range given by the
+  ///    offsets `i` and `i + 1` of `m_equationOffsets`. Each term
+  ///    is a coefficient and the index of its monomial.
+  /// This avoids chasing pointers through three levels of heap
+  /// allocations for each evaluation.
+  ///
+  /// The Jacobian of the system is derived exactly from the same
+  /// representation as the partial derivative of a monomial with
+  /// regard to one of its variables is closed-form. It is stored
+  /// in CSR form as well: the columns of the non-zero entries of
+  /// row `i` are in the range given by the offsets `i` and `i + 1`
+  /// of `jacobianOffsets()`. Each entry is the sum of the partial
+  /// derivatives of some monomials with regard to a dependency,
+  /// weighted by the coefficient of their terms.
+  class CompiledSystem {
+    public:
+
+      /**
+       * @brief - Create an empty compiled system.
+       */
+      CompiledSystem() = default;
+
+      /**
+       * @brief - Compile the input system into its flat form.
+       * @param system - the system to compile.
+       */
+      explicit
+      CompiledSystem(const System& system);
+
+      /**
+       * @brief - The number of equations in the system.
+       * @return - the number of equations.
+       */
+      unsigned
+      size() const noexcept;
+
+      /**
+       * @brief - The order of an equation: `1` if the equation gives
+       *          the derivative of the variable and `2` if it gives
+       *          its second derivative. The order of equations with
+       *          a lower order is `1`.
+       * @param eq - the index of the equation.
+       * @return - the order of the equation.
+       */
+      unsigned
+      order(unsigned eq) const noexcept;
+
+      /**
+       * @brief - The highest order of the equations of the system.
+       * @return - the order of the system.
+       */
+      unsigned
+      maxOrder() const noexcept;
+
+      /**
+       * @brief - The total number of terms across all equations.
+       * @return - the number of terms.
+       */
+      unsigned
+      terms() const noexcept;
+
+      /**
+       * @brief - The number of distinct monomials in the system.
+       * @return - the number of monomials.
+       */
+      unsigned
+      monomials() const noexcept;
+
+      /**
+       * @brief - Compute the derivative of a single variable from
+       *          the values of all the variables of the system.
+       *          Note that this does not use the shared table of
+       *          monomials: prefer `evaluate` when all derivatives
+       *          are needed.
+       * @param eq - the index of the equation to evaluate.
+       * @param values - the values of all variables.
+       * @return - the derivative for the variable.
+       */
+      float
+      derivative(unsigned eq, const float* values) const noexcept;
+
+      /**
+       * @brief - Compute the derivatives of all the variables of
+       *          the system at once. For second order equations
+       *          this is the second derivative of the variable.
+       *          Note that this method uses an internal buffer to
+       *          hold the monomials and is thus not safe to call
+       *          concurrently.
+       * @param values - the values of all variables.
+       * @param derivatives - output array which should be able to
+       *                      hold `size()` values.
+       */
+      void
+      evaluate(const float* values, float* derivatives) const noexcept;
+
+      /**
+       * @brief - The number of non-zero entries of the Jacobian.
+       * @return - the number of entries.
+       */
+      unsigned
+      jacobianEntries() const noexcept;
+
+      /**
+       * @brief - The offsets of the entries of each row of the
+       *          Jacobian: there are `size() + 1` of them.
+       * @return - the offsets of the rows.
+       */
+      const std::vector<unsigned>&
+      jacobianOffsets() const noexcept;
+
+      /**
+       * @brief - The column of each non-zero entry of the Jacobian,
+       *          sorted within each row.
+       * @return - the columns of the entries.
+       */
+      const std::vector<unsigned>&
+      jacobianColumns() const noexcept;
+
+      /**
+       * @brief - Compute the Jacobian of the system, i.e. the partial
+       *          derivative of each derivative with regard to each of
+       *          the variables. Only the non-zero entries are computed.
+       *          As `evaluate` this uses internal buffers and is thus
+       *          not safe to call concurrently.
+       * @param values - the values of all variables.
+       * @param entries - output array which should be able to hold
+       *                  `jacobianEntries()` values.
+       */
+      void
+      jacobian(const float* values, float* entries) const noexcept;
+
+    private:
+
+      /**
+       * @brief - Build the Jacobian structure from the compiled terms
+       *          and monomials.
+       */
+      void
+      compileJacobian();
+
+      /**
+       * @brief - Compute the value of a single monomial.
+       * @param monomial - the index of the monomial.
+       * @param values - the values of all variables.
+       * @return - the value of the monomial.
+       */
+      float
+      monomial(unsigned monomial, const float* values) const noexcept;
+
+    private:
+
+      /// @brief - The offsets of the terms of each equation: there
+      /// are `size() + 1` entries in this array.
+      std::vector<unsigned> m_equationOffsets;
+
+      /// @brief - The order of each equation.
+      std::vector<unsigned> m_orders;
+
+      /// @brief - The constant part of each term.
+      std::vector<float> m_coefficients;
+
+      /// @brief - The index of the monomial of each term.
+      std::vector<unsigned> m_termMonomials;
+
+      /// @brief - The offsets of the dependencies of each monomial:
+      /// there are `monomials() + 1` entries in this array.
+      std::vector<unsigned> m_monomialOffsets;
+
+      /// @brief - The variable index of each dependency.
+      std::vector<unsigned> m_ids;
+
+      /// @brief - The exponent of each dependency.
+      std::vector<float> m_exponents;
+
+      /// @brief - The kind of each exponent, used to pick the way
+      /// to evaluate the power of the variable.
+      std::vector<ExponentKind> m_kinds;
+
+      /// @brief - Scratch buffer holding the value of the monomials
+      /// during an evaluation. Allocated once at compilation.
+      mutable std::vector<float> m_monomialValues;
+
+      /// @brief - The offsets of the entries of each row of the
+      /// Jacobian: there are `size() + 1` entries in this array.
+      std::vector<unsigned> m_jacobianOffsets;
+
+      /// @brief - The column of each entry of the Jacobian.
+      std::vector<unsigned> m_jacobianColumns;
+
+      /// @brief - The offsets of the contributions to each entry of
+      /// the Jacobian: there are `jacobianEntries() + 1` entries in
+      /// this array.
+      std::vector<unsigned> m_contributionOffsets;
+
+      /// @brief - The coefficient of the term of each contribution.
+      std::vector<float> m_contributionCoefficients;
+
+      /// @brief - The index of the dependency with regard to which
+      /// the monomial of each contribution is derived.
+      std::vector<unsigned> m_contributionDependencies;
+
+      /// @brief - Scratch buffers holding the value of the power of
+      /// each dependency and the partial derivative of its monomial
+      /// with regard to it during the computation of the Jacobian.
+      mutable std::vector<float> m_factors;
+      mutable std::vector<float> m_partials;
+  };
+
+}
+
+#endif    /* COMPILED_SYSTEM_HH */
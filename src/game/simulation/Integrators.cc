@@ -0,0 +1,1039 @@
+
+# include "Integrators.hh"
+# include <cmath>
+# include <limits>
+# include <algorithm>
+
+namespace {
+
+  /// @brief - The default absolute tolerance of adaptive integrators.
+  constexpr auto DEFAULT_ABSOLUTE_TOLERANCE = 1e-6f;
+
+  /// @brief - The default relative tolerance of adaptive integrators.
+  constexpr auto DEFAULT_RELATIVE_TOLERANCE = 1e-4f;
+
+  /// @brief - The fraction of the optimal step size actually used,
+  /// to make it likely that the next step is accepted.
+  constexpr auto STEP_SAFETY = 0.9f;
+
+  /// @brief - The bounds of the factor applied to the step size
+  /// after each attempt.
+  constexpr auto MIN_STEP_FACTOR = 0.2f;
+  constexpr auto MAX_STEP_FACTOR = 10.0f;
+
+  /// @brief - The exponents of the proportional-integral controller
+  /// of the step size, as suggested by Hairer and Wanner for an
+  /// order 5 method.
+  constexpr auto CONTROLLER_BETA = 0.04f;
+  constexpr auto CONTROLLER_ALPHA = 0.2f - 0.75f * CONTROLLER_BETA;
+
+  /// @brief - The lower bound of the error of a step used by the
+  /// controller, which avoids too large factors.
+  constexpr auto MIN_CONTROLLER_ERROR = 1e-4f;
+
+  /// @brief - The smallest internal step allowed, relative to the
+  /// requested step.
+  constexpr auto MIN_STEP_RATIO = 1e-6f;
+
+  /// @brief - The coefficients of the Dormand-Prince method:
+  /// https://en.wikipedia.org/wiki/Dormand%E2%80%93Prince_method
+  /// The time coefficients are not needed as the systems do not
+  /// depend explicitly on the time.
+  constexpr auto A21 = 1.0f / 5.0f;
+
+  constexpr auto A31 = 3.0f / 40.0f;
+  constexpr auto A32 = 9.0f / 40.0f;
+
+  constexpr auto A41 = 44.0f / 45.0f;
+  constexpr auto A42 = -56.0f / 15.0f;
+  constexpr auto A43 = 32.0f / 9.0f;
+
+  constexpr auto A51 = 19372.0f / 6561.0f;
+  constexpr auto A52 = -25360.0f / 2187.0f;
+  constexpr auto A53 = 64448.0f / 6561.0f;
+  constexpr auto A54 = -212.0f / 729.0f;
+
+  constexpr auto A61 = 9017.0f / 3168.0f;
+  constexpr auto A62 = -355.0f / 33.0f;
+  constexpr auto A63 = 46732.0f / 5247.0f;
+  constexpr auto A64 = 49.0f / 176.0f;
+  constexpr auto A65 = -5103.0f / 18656.0f;
+
+  /// @brief - The weights of the order 5 solution, which are also
+  /// the coefficients of the last stage.
+  constexpr auto B1 = 35.0f / 384.0f;
+  constexpr auto B3 = 500.0f / 1113.0f;
+  constexpr auto B4 = 125.0f / 192.0f;
+  constexpr auto B5 = -2187.0f / 6784.0f;
+  constexpr auto B6 = 11.0f / 84.0f;
+
+  /// @brief - The difference between the weights of the order 5 and
+  /// order 4 solutions, used to estimate the error.
+  constexpr auto E1 = 71.0f / 57600.0f;
+  constexpr auto E3 = -71.0f / 16695.0f;
+  constexpr auto E4 = 71.0f / 1920.0f;
+  constexpr auto E5 = -17253.0f / 339200.0f;
+  constexpr auto E6 = 22.0f / 525.0f;
+  constexpr auto E7 = -1.0f / 40.0f;
+
+  /// @brief - The coefficients of the dense output, from the
+  /// `DOPRI5` code of Hairer and Wanner.
+  constexpr auto D1 = -12715105075.0f / 11282082432.0f;
+  constexpr auto D3 = 87487479700.0f / 32700410799.0f;
+  constexpr auto D4 = -10690763975.0f / 1880347072.0f;
+  constexpr auto D5 = 701980252875.0f / 199316789632.0f;
+  constexpr auto D6 = -1453857185.0f / 822651844.0f;
+  constexpr auto D7 = 69997945.0f / 29380423.0f;
+
+  /// @brief - The number of coefficients of the interpolating
+  /// polynomial for each variable.
+  constexpr auto DENSE_COEFFICIENTS = 5u;
+
+  /// @brief - The coefficient of the Rosenbrock method of order 2,
+  /// `1 + 1 / sqrt(2)`, which makes it L-stable.
+  constexpr auto ROSENBROCK_GAMMA = 1.70710678f;
+
+  /// @brief - The number of steps during which the Jacobian is
+  /// reused by the Rosenbrock method.
+  constexpr auto JACOBIAN_REFRESH_STEPS = 8u;
+
+  /// @brief - The maximum number of iterations to solve for the
+  /// values at the end of a step of the BDF method.
+  constexpr auto MAX_NEWTON_ITERATIONS = 4u;
+
+  /// @brief - The number of evaluations of the derivatives for each
+  /// step of the Dormand-Prince method, the first stage being reused.
+  constexpr auto DORMAND_PRINCE_EVALUATIONS = 6u;
+
+  /// @brief - The extent of the stability region of the Dormand-Prince
+  /// method along the negative real axis.
+  constexpr auto DORMAND_PRINCE_STABILITY_LIMIT = 3.3f;
+
+  /// @brief - The fraction of the stability limit above which the
+  /// steps of the explicit method are considered to be limited by
+  /// the stability rather than by the accuracy.
+  constexpr auto STABILITY_LIMITED_RATIO = 0.5f;
+
+  /// @brief - The fraction of rejected steps above which the steps
+  /// of the explicit method are considered to be limited by the
+  /// stability.
+  constexpr auto STIFF_REJECTION_RATIO = 0.25f;
+
+  /// @brief - The approximate cost of a step of the Rosenbrock method
+  /// in evaluations of the derivatives: two evaluations, along with
+  /// the Jacobian and the factorization from time to time.
+  constexpr auto IMPLICIT_STEP_COST = 3.0f;
+
+  /// @brief - How much cheaper a method should be to switch to it.
+  constexpr auto SWITCH_MARGIN = 2.0f;
+
+  /// @brief - The number of steps between two checks of the stiffness.
+  constexpr auto STIFFNESS_CHECK_STEPS = 16u;
+
+  /// @brief - The number of power iterations used to estimate the
+  /// spectral radius of the Jacobian.
+  constexpr auto POWER_ITERATIONS = 8u;
+
+}
+
+namespace eqdif {
+
+  Tolerance
+  defaultTolerance() noexcept {
+    return Tolerance{
+      DEFAULT_ABSOLUTE_TOLERANCE, // absolute
+      DEFAULT_RELATIVE_TOLERANCE  // relative
+    };
+  }
+
+  bool
+  clampToRanges(const std::vector<Range>& ranges, float* values) noexcept {
+    bool changed = false;
+
+    for (unsigned id = 0u ; id < ranges.size() ; ++id) {
+      const auto [lb, hb] = ranges[id];
+      const float value = std::clamp(values[id], lb, hb);
+
+      changed = changed || (value != values[id]);
+      values[id] = value;
+    }
+
+    return changed;
+  }
+
+  EulerIntegrator::EulerIntegrator(unsigned size):
+    m_k(size, 0.0f)
+  {}
+
+  void
+  EulerIntegrator::step(const CompiledSystem& system,
+                        const float* in,
+                        float* out,
+                        float dt) noexcept
+  {
+    // https://en.wikipedia.org/wiki/Euler_method
+    const unsigned n = system.size();
+
+    system.evaluate(in, m_k.data());
+
+    for (unsigned id = 0u ; id < n ; ++id) {
+      out[id] = in[id] + dt * m_k[id];
+    }
+  }
+
+  void
+  EulerIntegrator::clamp(const CompiledSystem& /*system*/,
+                         const std::vector<Range>& ranges,
+                         float* out) noexcept
+  {
+    clampToRanges(ranges, out);
+  }
+
+  RungeKutta4Integrator::RungeKutta4Integrator(unsigned size):
+    m_k1(size, 0.0f),
+    m_k2(size, 0.0f),
+    m_k3(size, 0.0f),
+    m_k4(size, 0.0f),
+
+    m_tmp(size, 0.0f)
+  {}
+
+  void
+  RungeKutta4Integrator::step(const CompiledSystem& system,
+                              const float* in,
+                              float* out,
+                              float dt) noexcept
+  {
+    system.evaluate(in, m_k1.data());
+    step(system, in, m_k1.data(), out, dt);
+  }
+
+  void
+  RungeKutta4Integrator::step(const CompiledSystem& system,
+                              const float* in,
+                              const float* k1,
+                              float* out,
+                              float dt) noexcept
+  {
+    // https://en.wikipedia.org/wiki/Runge%E2%80%93Kutta_methods
+    // Each stage evaluates the derivatives of the whole system
+    // at the state predicted by the previous stage.
+    const unsigned n = system.size();
+
+    for (unsigned id = 0u ; id < n ; ++id) {
+      m_tmp[id] = in[id] + 0.5f * dt * k1[id];
+    }
+    system.evaluate(m_tmp.data(), m_k2.data());
+
+    for (unsigned id = 0u ; id < n ; ++id) {
+      m_tmp[id] = in[id] + 0.5f * dt * m_k2[id];
+    }
+    system.evaluate(m_tmp.data(), m_k3.data());
+
+    for (unsigned id = 0u ; id < n ; ++id) {
+      m_tmp[id] = in[id] + dt * m_k3[id];
+    }
+    system.evaluate(m_tmp.data(), m_k4.data());
+
+    for (unsigned id = 0u ; id < n ; ++id) {
+      out[id] = in[id] + (dt / 6.0f) * (k1[id] + 2.0f * m_k2[id] + 2.0f * m_k3[id] + m_k4[id]);
+    }
+  }
+
+  void
+  RungeKutta4Integrator::clamp(const CompiledSystem& /*system*/,
+                               const std::vector<Range>& ranges,
+                               float* out) noexcept
+  {
+    clampToRanges(ranges, out);
+  }
+
+  DormandPrince45Integrator::DormandPrince45Integrator(unsigned size,
+                                                       const Tolerance& tolerance):
+    m_size(size),
+    m_tolerance(tolerance),
+
+    m_started(false),
+    m_time(0.0),
+    m_start(0.0),
+    m_end(0.0),
+    m_h(0.0f),
+    m_previousError(MIN_CONTROLLER_ERROR),
+    m_rejected(false),
+    m_evaluations(0u),
+    m_rejections(0u),
+
+    m_y(size, 0.0f),
+    m_next(size, 0.0f),
+    m_last(size, 0.0f),
+
+    m_k1(size, 0.0f),
+    m_k2(size, 0.0f),
+    m_k3(size, 0.0f),
+    m_k4(size, 0.0f),
+    m_k5(size, 0.0f),
+    m_k6(size, 0.0f),
+    m_k7(size, 0.0f),
+
+    m_tmp(size, 0.0f),
+    m_dense(DENSE_COEFFICIENTS * size, 0.0f)
+  {}
+
+  void
+  DormandPrince45Integrator::step(const CompiledSystem& system,
+                                  const float* in,
+                                  float* out,
+                                  float dt) noexcept
+  {
+    if (dt <= 0.0f) {
+      std::copy(in, in + m_size, out);
+      return;
+    }
+
+    // Continue the integration only if the values were not changed
+    // since they were produced.
+    if (!m_started || !std::equal(in, in + m_size, m_last.begin())) {
+      restart(system, in);
+    }
+
+    if (m_h <= 0.0f) {
+      m_h = dt;
+    }
+
+    // Take internal steps until the requested time is covered by the
+    // last one: it may already be the case if the steps are large.
+    const double target = m_time + dt;
+    const float minimum = MIN_STEP_RATIO * dt;
+
+    while (m_end < target) {
+      attempt(system, minimum);
+    }
+
+    interpolate(target, out);
+
+    m_time = target;
+    std::copy(out, out + m_size, m_last.begin());
+  }
+
+  void
+  DormandPrince45Integrator::clamp(const CompiledSystem& system,
+                                   const std::vector<Range>& ranges,
+                                   float* out) noexcept
+  {
+    // The last accepted step usually ends after the produced values:
+    // its end is bounded as well so that the next step continues from
+    // it. The position of the produced values within the step is used
+    // to interpolate the rest of the step.
+    const double length = m_end - m_start;
+    const float theta = (length > 0.0 ? static_cast<float>((m_time - m_start) / length) : 1.0f);
+    bool changed = false;
+
+    for (unsigned id = 0u ; id < ranges.size() ; ++id) {
+      const auto [lb, hb] = ranges[id];
+      const float value = std::clamp(out[id], lb, hb);
+      const float end = std::clamp(m_y[id], lb, hb);
+
+      if (value == out[id] && end == m_y[id]) {
+        continue;
+      }
+
+      out[id] = value;
+      if (!m_started) {
+        continue;
+      }
+
+      changed = changed || (end != m_y[id]);
+      m_y[id] = end;
+
+      // The polynomial of the step would leave the range again: the
+      // rest of the step is interpolated linearly between the bounded
+      // values instead, which stays within the range.
+      float* dense = m_dense.data() + id * DENSE_COEFFICIENTS;
+      const float slope = (theta < 1.0f ? (end - value) / (1.0f - theta) : 0.0f);
+
+      dense[0] = end - slope;
+      dense[1] = slope;
+      dense[2] = 0.0f;
+      dense[3] = 0.0f;
+      dense[4] = 0.0f;
+    }
+
+    std::copy(out, out + m_size, m_last.begin());
+
+    // The derivatives reused by the next step are computed again if
+    // the end of the step changed.
+    if (changed) {
+      system.evaluate(m_y.data(), m_k1.data());
+      ++m_evaluations;
+    }
+  }
+
+  float
+  DormandPrince45Integrator::stepSize() const noexcept {
+    return m_h;
+  }
+
+  std::size_t
+  DormandPrince45Integrator::evaluations() const noexcept {
+    return m_evaluations;
+  }
+
+  std::size_t
+  DormandPrince45Integrator::rejections() const noexcept {
+    return m_rejections;
+  }
+
+  void
+  DormandPrince45Integrator::restart(const CompiledSystem& system, const float* in) noexcept {
+    // The step size is kept as a first guess.
+    std::copy(in, in + m_size, m_y.begin());
+    m_start = m_time;
+    m_end = m_time;
+
+    m_previousError = MIN_CONTROLLER_ERROR;
+    m_rejected = false;
+
+    system.evaluate(m_y.data(), m_k1.data());
+    ++m_evaluations;
+    m_started = true;
+  }
+
+  bool
+  DormandPrince45Integrator::attempt(const CompiledSystem& system, float minimum) noexcept {
+    const float h = std::max(m_h, minimum);
+    const unsigned n = m_size;
+
+    // The first stage is the last one of the previous step.
+    for (unsigned id = 0u ; id < n ; ++id) {
+      m_tmp[id] = m_y[id] + h * A21 * m_k1[id];
+    }
+    system.evaluate(m_tmp.data(), m_k2.data());
+
+    for (unsigned id = 0u ; id < n ; ++id) {
+      m_tmp[id] = m_y[id] + h * (A31 * m_k1[id] + A32 * m_k2[id]);
+    }
+    system.evaluate(m_tmp.data(), m_k3.data());
+
+    for (unsigned id = 0u ; id < n ; ++id) {
+      m_tmp[id] = m_y[id] + h * (A41 * m_k1[id] + A42 * m_k2[id] + A43 * m_k3[id]);
+    }
+    system.evaluate(m_tmp.data(), m_k4.data());
+
+    for (unsigned id = 0u ; id < n ; ++id) {
+      m_tmp[id] = m_y[id] + h * (A51 * m_k1[id] + A52 * m_k2[id] + A53 * m_k3[id] + A54 * m_k4[id]);
+    }
+    system.evaluate(m_tmp.data(), m_k5.data());
+
+    for (unsigned id = 0u ; id < n ; ++id) {
+      m_tmp[id] = m_y[id] + h * (
+        A61 * m_k1[id] + A62 * m_k2[id] + A63 * m_k3[id] + A64 * m_k4[id] + A65 * m_k5[id]
+      );
+    }
+    system.evaluate(m_tmp.data(), m_k6.data());
+
+    for (unsigned id = 0u ; id < n ; ++id) {
+      m_next[id] = m_y[id] + h * (
+        B1 * m_k1[id] + B3 * m_k3[id] + B4 * m_k4[id] + B5 * m_k5[id] + B6 * m_k6[id]
+      );
+    }
+    system.evaluate(m_next.data(), m_k7.data());
+    m_evaluations += DORMAND_PRINCE_EVALUATIONS;
+
+    // Estimate the error as the root mean square of the difference
+    // with the order 4 solution, relative to the tolerance.
+    float sum = 0.0f;
+    for (unsigned id = 0u ; id < n ; ++id) {
+      const float e = h * (
+        E1 * m_k1[id] + E3 * m_k3[id] + E4 * m_k4[id] +
+        E5 * m_k5[id] + E6 * m_k6[id] + E7 * m_k7[id]
+      );
+      const float scale = m_tolerance.absolute + m_tolerance.relative * std::max(std::abs(m_y[id]), std::abs(m_next[id]));
+      sum += (e / scale) * (e / scale);
+    }
+
+    const float err = (n > 0u ? std::sqrt(sum / n) : 0.0f);
+    const bool finite = std::isfinite(err);
+    const bool accepted = (finite && err <= 1.0f) || h <= minimum;
+
+    if (!accepted) {
+      const float factor = (finite ? STEP_SAFETY * std::pow(err, -CONTROLLER_ALPHA) : MIN_STEP_FACTOR);
+      m_h = h * std::max(MIN_STEP_FACTOR, factor);
+      m_rejected = true;
+      ++m_rejections;
+
+      return false;
+    }
+
+    // Proportional-integral control of the step size: the error of
+    // the previous step damps the variations.
+    float factor = MAX_STEP_FACTOR;
+    if (finite && err > 0.0f) {
+      factor = STEP_SAFETY * std::pow(err, -CONTROLLER_ALPHA) * std::pow(m_previousError, CONTROLLER_BETA);
+      factor = std::clamp(factor, MIN_STEP_FACTOR, MAX_STEP_FACTOR);
+    }
+    if (m_rejected) {
+      factor = std::min(factor, 1.0f);
+    }
+
+    m_h = h * factor;
+    m_previousError = (finite ? std::max(err, MIN_CONTROLLER_ERROR) : 1.0f);
+    m_rejected = false;
+
+    // Prepare the interpolation over the step.
+    for (unsigned id = 0u ; id < n ; ++id) {
+      float* dense = m_dense.data() + id * DENSE_COEFFICIENTS;
+      const float diff = m_next[id] - m_y[id];
+      const float spline = h * m_k1[id] - diff;
+
+      dense[0] = m_y[id];
+      dense[1] = diff;
+      dense[2] = spline;
+      dense[3] = diff - h * m_k7[id] - spline;
+      dense[4] = h * (
+        D1 * m_k1[id] + D3 * m_k3[id] + D4 * m_k4[id] +
+        D5 * m_k5[id] + D6 * m_k6[id] + D7 * m_k7[id]
+      );
+    }
+
+    m_start = m_end;
+    m_end += h;
+
+    // The derivatives at the end of the step start the next one.
+    m_y.swap(m_next);
+    m_k1.swap(m_k7);
+
+    return true;
+  }
+
+  void
+  DormandPrince45Integrator::interpolate(double t, float* out) const noexcept {
+    const float theta = static_cast<float>((t - m_start) / (m_end - m_start));
+    const float theta1 = 1.0f - theta;
+
+    for (unsigned id = 0u ; id < m_size ; ++id) {
+      const float* dense = m_dense.data() + id * DENSE_COEFFICIENTS;
+      out[id] = dense[0] + theta * (dense[1] + theta1 * (dense[2] + theta * (dense[3] + theta1 * dense[4])));
+    }
+  }
+
+  Rosenbrock2Integrator::Rosenbrock2Integrator(const CompiledSystem& system):
+    m_age(JACOBIAN_REFRESH_STEPS),
+    m_jacobian(system.jacobianEntries(), 0.0f),
+    m_matrix(system.size()),
+
+    m_k1(system.size(), 0.0f),
+    m_k2(system.size(), 0.0f),
+
+    m_tmp(system.size(), 0.0f)
+  {}
+
+  void
+  Rosenbrock2Integrator::step(const CompiledSystem& system,
+                              const float* in,
+                              float* out,
+                              float dt) noexcept
+  {
+    // https://doi.org/10.1137/S1064827597326651
+    //   (I - gamma dt J) k1 = f(y)
+    //   (I - gamma dt J) k2 = f(y + dt k1) - 2 k1
+    //   y' = y + 3/2 dt k1 + 1/2 dt k2
+    const unsigned n = system.size();
+    const float gamma = ROSENBROCK_GAMMA * dt;
+
+    if (m_age >= JACOBIAN_REFRESH_STEPS || !m_matrix.factorized() || m_matrix.gamma() != gamma) {
+      system.jacobian(in, m_jacobian.data());
+      m_matrix.factorize(system, m_jacobian.data(), gamma);
+      m_age = 0u;
+    }
+    ++m_age;
+
+    system.evaluate(in, m_k1.data());
+
+    // The matrix can only be singular for some unstable systems: the
+    // step degrades to an explicit Euler step in this case.
+    if (!m_matrix.factorized()) {
+      for (unsigned id = 0u ; id < n ; ++id) {
+        out[id] = in[id] + dt * m_k1[id];
+      }
+
+      return;
+    }
+
+    m_matrix.solve(m_k1.data());
+
+    for (unsigned id = 0u ; id < n ; ++id) {
+      m_tmp[id] = in[id] + dt * m_k1[id];
+    }
+    system.evaluate(m_tmp.data(), m_k2.data());
+
+    for (unsigned id = 0u ; id < n ; ++id) {
+      m_k2[id] -= 2.0f * m_k1[id];
+    }
+    m_matrix.solve(m_k2.data());
+
+    for (unsigned id = 0u ; id < n ; ++id) {
+      out[id] = in[id] + dt * (1.5f * m_k1[id] + 0.5f * m_k2[id]);
+    }
+  }
+
+  void
+  Rosenbrock2Integrator::clamp(const CompiledSystem& /*system*/,
+                               const std::vector<Range>& ranges,
+                               float* out) noexcept
+  {
+    clampToRanges(ranges, out);
+  }
+
+  void
+  Rosenbrock2Integrator::refresh() noexcept {
+    m_age = JACOBIAN_REFRESH_STEPS;
+  }
+
+  Bdf2Integrator::Bdf2Integrator(const CompiledSystem& system,
+                                 const Tolerance& tolerance):
+    m_size(system.size()),
+    m_tolerance(tolerance),
+
+    m_started(false),
+    m_dt(0.0f),
+    m_fresh(false),
+
+    m_jacobian(system.jacobianEntries(), 0.0f),
+    m_matrix(system.size()),
+
+    m_previous(system.size(), 0.0f),
+    m_last(system.size(), 0.0f),
+    m_base(system.size(), 0.0f),
+    m_f(system.size(), 0.0f),
+    m_delta(system.size(), 0.0f)
+  {}
+
+  void
+  Bdf2Integrator::step(const CompiledSystem& system,
+                       const float* in,
+                       float* out,
+                       float dt) noexcept
+  {
+    // https://en.wikipedia.org/wiki/Backward_differentiation_formula
+    // The values at the end of the step are the solution of:
+    //   y' - gamma f(y') = base
+    // With the order 1 formula `gamma = dt` and `base = y`, and with
+    // the order 2 one `gamma = 2/3 dt` and `base = 4/3 y - 1/3 y-1`.
+    const unsigned n = m_size;
+    const bool history = m_started && dt == m_dt && std::equal(in, in + n, m_last.begin());
+
+    const float gamma = (history ? 2.0f / 3.0f : 1.0f) * dt;
+    for (unsigned id = 0u ; id < n ; ++id) {
+      m_base[id] = (history ? (4.0f * in[id] - m_previous[id]) / 3.0f : in[id]);
+
+      // Extrapolate the past values for the initial guess.
+      out[id] = (history ? 2.0f * in[id] - m_previous[id] : in[id]);
+    }
+
+    m_fresh = false;
+    if (!m_matrix.factorized() || m_matrix.gamma() != gamma) {
+      system.jacobian(in, m_jacobian.data());
+      m_matrix.factorize(system, m_jacobian.data(), gamma);
+      m_fresh = true;
+    }
+
+    if (!solve(system, gamma, out) && !m_fresh) {
+      // The Jacobian is probably out of date: refresh it and
+      // start again from the initial guess.
+      system.jacobian(in, m_jacobian.data());
+      m_matrix.factorize(system, m_jacobian.data(), gamma);
+      m_fresh = true;
+
+      for (unsigned id = 0u ; id < n ; ++id) {
+        out[id] = (history ? 2.0f * in[id] - m_previous[id] : in[id]);
+      }
+
+      // The last iterate is used even if the iteration does not
+      // converge: the duration of the step can't be reduced.
+      solve(system, gamma, out);
+    }
+
+    std::copy(in, in + n, m_previous.begin());
+    std::copy(out, out + n, m_last.begin());
+    m_dt = dt;
+    m_started = true;
+  }
+
+  void
+  Bdf2Integrator::clamp(const CompiledSystem& /*system*/,
+                        const std::vector<Range>& ranges,
+                        float* out) noexcept
+  {
+    // The bounded values are the ones the next step continues from:
+    // the order 2 formula is kept and the factorization reused.
+    clampToRanges(ranges, out);
+    std::copy(out, out + m_size, m_last.begin());
+  }
+
+  bool
+  Bdf2Integrator::solve(const CompiledSystem& system, float gamma, float* out) noexcept {
+    // The matrix can only be singular for some unstable systems: the
+    // initial guess is kept in this case.
+    if (!m_matrix.factorized()) {
+      return false;
+    }
+
+    const unsigned n = m_size;
+    float previous = std::numeric_limits<float>::max();
+
+    for (unsigned iteration = 0u ; iteration < MAX_NEWTON_ITERATIONS ; ++iteration) {
+      system.evaluate(out, m_f.data());
+
+      for (unsigned id = 0u ; id < n ; ++id) {
+        m_delta[id] = m_base[id] + gamma * m_f[id] - out[id];
+      }
+      m_matrix.solve(m_delta.data());
+
+      // Measure the correction relative to the tolerance.
+      float sum = 0.0f;
+      for (unsigned id = 0u ; id < n ; ++id) {
+        out[id] += m_delta[id];
+
+        const float scale = m_tolerance.absolute + m_tolerance.relative * std::abs(out[id]);
+        sum += (m_delta[id] / scale) * (m_delta[id] / scale);
+      }
+
+      const float norm = (n > 0u ? std::sqrt(sum / n) : 0.0f);
+      if (norm <= 1.0f) {
+        return true;
+      }
+
+      // Stop early if the iteration diverges.
+      if (!std::isfinite(norm) || norm > previous) {
+        return false;
+      }
+
+      previous = norm;
+    }
+
+    return false;
+  }
+
+  VelocityVerletIntegrator::VelocityVerletIntegrator(const CompiledSystem& system):
+    m_size(system.size()),
+    m_secondOrder(system.size(), false),
+
+    m_started(false),
+    m_seeded(false),
+
+    m_previous(system.size(), 0.0f),
+    m_velocities(system.size(), 0.0f),
+    m_f(system.size(), 0.0f),
+    m_next(system.size(), 0.0f),
+    m_last(system.size(), 0.0f)
+  {
+    for (unsigned id = 0u ; id < m_size ; ++id) {
+      m_secondOrder[id] = (system.order(id) == 2u);
+    }
+  }
+
+  void
+  VelocityVerletIntegrator::seed(const float* previous) {
+    std::copy(previous, previous + m_size, m_previous.begin());
+    m_seeded = true;
+  }
+
+  void
+  VelocityVerletIntegrator::step(const CompiledSystem& system,
+                                 const float* in,
+                                 float* out,
+                                 float dt) noexcept
+  {
+    // https://en.wikipedia.org/wiki/Verlet_integration#Velocity_Verlet
+    const unsigned n = m_size;
+
+    if (!m_started || !std::equal(in, in + n, m_last.begin())) {
+      restart(system, in, dt);
+    }
+
+    // Move the positions with the current velocities and accelerations
+    // and predict the other variables.
+    for (unsigned id = 0u ; id < n ; ++id) {
+      if (m_secondOrder[id]) {
+        out[id] = in[id] + dt * m_velocities[id] + 0.5f * dt * dt * m_f[id];
+      }
+      else {
+        out[id] = in[id] + dt * m_f[id];
+      }
+    }
+
+    system.evaluate(out, m_next.data());
+
+    // Update the velocities with the average acceleration over the
+    // step and correct the other variables in the same way.
+    for (unsigned id = 0u ; id < n ; ++id) {
+      if (m_secondOrder[id]) {
+        m_velocities[id] += 0.5f * dt * (m_f[id] + m_next[id]);
+      }
+      else {
+        out[id] = in[id] + 0.5f * dt * (m_f[id] + m_next[id]);
+      }
+    }
+
+    // The derivatives at the end of the step start the next one.
+    m_f.swap(m_next);
+    std::copy(out, out + n, m_last.begin());
+  }
+
+  void
+  VelocityVerletIntegrator::clamp(const CompiledSystem& /*system*/,
+                                  const std::vector<Range>& ranges,
+                                  float* out) noexcept
+  {
+    clampToRanges(ranges, out);
+  }
+
+  void
+  VelocityVerletIntegrator::restart(const CompiledSystem& system, const float* in, float dt) noexcept {
+    for (unsigned id = 0u ; id < m_size ; ++id) {
+      if (!m_secondOrder[id]) {
+        continue;
+      }
+
+      if (m_seeded && dt > 0.0f) {
+        m_velocities[id] = (in[id] - m_previous[id]) / dt;
+      }
+      else if (m_started && in[id] != m_last[id]) {
+        // The variable was moved from the outside (e.g. it reached
+        // one of its bounds): it stops there.
+        m_velocities[id] = 0.0f;
+      }
+    }
+
+    system.evaluate(in, m_f.data());
+
+    m_seeded = false;
+    m_started = true;
+  }
+
+  AdamsBashforthMoultonIntegrator::AdamsBashforthMoultonIntegrator(unsigned size):
+    m_size(size),
+    m_bootstrap(size),
+    m_dt(0.0f),
+
+    m_history(ADAMS_ORDER * size, 0.0f),
+    m_head(0u),
+    m_count(0u),
+
+    m_last(size, 0.0f),
+    m_predicted(size, 0.0f),
+    m_f(size, 0.0f)
+  {}
+
+  void
+  AdamsBashforthMoultonIntegrator::step(const CompiledSystem& system,
+                                        const float* in,
+                                        float* out,
+                                        float dt) noexcept
+  {
+    // https://en.wikipedia.org/wiki/Linear_multistep_method
+    const unsigned n = m_size;
+
+    if (m_count > 0u && (dt != m_dt || !std::equal(in, in + n, m_last.begin()))) {
+      m_count = 0u;
+    }
+
+    // The derivatives are computed at the start of the step rather
+    // than at the end of the previous one: this way they are the ones
+    // of the clamped values.
+    push(system, in);
+
+    if (m_count < ADAMS_ORDER) {
+      // Not enough past steps yet.
+      m_bootstrap.step(system, in, derivatives(0u), out, dt);
+    }
+    else {
+      const float* f0 = derivatives(0u);
+      const float* f1 = derivatives(1u);
+      const float* f2 = derivatives(2u);
+      const float* f3 = derivatives(3u);
+
+      // Predict with Adams-Bashforth.
+      for (unsigned id = 0u ; id < n ; ++id) {
+        m_predicted[id] = in[id] + (dt / 24.0f) * (55.0f * f0[id] - 59.0f * f1[id] + 37.0f * f2[id] - 9.0f * f3[id]);
+      }
+      system.evaluate(m_predicted.data(), m_f.data());
+
+      // Correct with Adams-Moulton.
+      for (unsigned id = 0u ; id < n ; ++id) {
+        out[id] = in[id] + (dt / 24.0f) * (9.0f * m_f[id] + 19.0f * f0[id] - 5.0f * f1[id] + f2[id]);
+      }
+    }
+
+    std::copy(out, out + n, m_last.begin());
+    m_dt = dt;
+  }
+
+  void
+  AdamsBashforthMoultonIntegrator::clamp(const CompiledSystem& /*system*/,
+                                         const std::vector<Range>& ranges,
+                                         float* out) noexcept
+  {
+    clampToRanges(ranges, out);
+    std::copy(out, out + m_size, m_last.begin());
+  }
+
+  const float*
+  AdamsBashforthMoultonIntegrator::derivatives(unsigned age) const noexcept {
+    return m_history.data() + ((m_head + ADAMS_ORDER - age) % ADAMS_ORDER) * m_size;
+  }
+
+  void
+  AdamsBashforthMoultonIntegrator::push(const CompiledSystem& system, const float* values) noexcept {
+    m_head = (m_head + 1u) % ADAMS_ORDER;
+    system.evaluate(values, m_history.data() + m_head * m_size);
+    m_count = std::min(m_count + 1u, ADAMS_ORDER);
+  }
+
+  AutomaticIntegrator::AutomaticIntegrator(const CompiledSystem& system,
+                                           const Tolerance& tolerance):
+    m_explicit(system.size(), tolerance),
+    m_implicit(system),
+
+    m_stiff(false),
+    m_steps(STIFFNESS_CHECK_STEPS),
+    m_evaluations(0u),
+    m_rejections(0u),
+
+    m_jacobian(system.jacobianEntries(), 0.0f),
+    m_vector(system.size(), 0.0f),
+    m_product(system.size(), 0.0f)
+  {}
+
+  void
+  AutomaticIntegrator::step(const CompiledSystem& system,
+                            const float* in,
+                            float* out,
+                            float dt) noexcept
+  {
+    if (m_steps >= STIFFNESS_CHECK_STEPS) {
+      select(system, in, dt);
+      m_steps = 0u;
+    }
+    ++m_steps;
+
+    if (m_stiff) {
+      m_implicit.step(system, in, out, dt);
+    }
+    else {
+      m_explicit.step(system, in, out, dt);
+    }
+  }
+
+  void
+  AutomaticIntegrator::clamp(const CompiledSystem& system,
+                             const std::vector<Range>& ranges,
+                             float* out) noexcept
+  {
+    if (m_stiff) {
+      m_implicit.clamp(system, ranges, out);
+    }
+    else {
+      m_explicit.clamp(system, ranges, out);
+    }
+  }
+
+  bool
+  AutomaticIntegrator::stiff() const noexcept {
+    return m_stiff;
+  }
+
+  void
+  AutomaticIntegrator::select(const CompiledSystem& system, const float* in, float dt) noexcept {
+    const float radius = spectralRadius(system, in);
+
+    // The number of evaluations needed by the explicit method for
+    // each step if its steps are limited by the stability.
+    const float predicted = DORMAND_PRINCE_EVALUATIONS * dt * radius / DORMAND_PRINCE_STABILITY_LIMIT;
+
+    const std::size_t evaluations = m_explicit.evaluations() - m_evaluations;
+    const std::size_t rejections = m_explicit.rejections() - m_rejections;
+    m_evaluations = m_explicit.evaluations();
+    m_rejections = m_explicit.rejections();
+
+    if (m_stiff) {
+      if (predicted * SWITCH_MARGIN < IMPLICIT_STEP_COST) {
+        m_stiff = false;
+      }
+
+      return;
+    }
+
+    // Use the actual cost of the explicit method if it was used
+    // since the last check, and the prediction otherwise.
+    float cost = predicted;
+    bool limited = true;
+
+    if (evaluations > 0u && m_steps > 0u) {
+      cost = static_cast<float>(evaluations) / m_steps;
+      limited = (
+        m_explicit.stepSize() * radius >= STABILITY_LIMITED_RATIO * DORMAND_PRINCE_STABILITY_LIMIT ||
+        rejections >= STIFF_REJECTION_RATIO * evaluations / DORMAND_PRINCE_EVALUATIONS
+      );
+    }
+
+    if (limited && cost > SWITCH_MARGIN * IMPLICIT_STEP_COST) {
+      m_stiff = true;
+      m_implicit.refresh();
+    }
+  }
+
+  float
+  AutomaticIntegrator::spectralRadius(const CompiledSystem& system, const float* in) noexcept {
+    // https://en.wikipedia.org/wiki/Power_iteration
+    const unsigned n = system.size();
+    if (n == 0u) {
+      return 0.0f;
+    }
+
+    system.jacobian(in, m_jacobian.data());
+
+    // Start from a vector which is unlikely to be orthogonal to the
+    // dominant eigenvector.
+    float norm = 0.0f;
+    for (unsigned id = 0u ; id < n ; ++id) {
+      m_vector[id] = 1.0f + 0.5f * (id % 3u);
+      norm += m_vector[id] * m_vector[id];
+    }
+    norm = std::sqrt(norm);
+    for (unsigned id = 0u ; id < n ; ++id) {
+      m_vector[id] /= norm;
+    }
+
+    const std::vector<unsigned>& offsets = system.jacobianOffsets();
+    const std::vector<unsigned>& columns = system.jacobianColumns();
+
+    float radius = 0.0f;
+    for (unsigned iteration = 0u ; iteration < POWER_ITERATIONS ; ++iteration) {
+      norm = 0.0f;
+      for (unsigned row = 0u ; row < n ; ++row) {
+        float sum = 0.0f;
+        for (unsigned entry = offsets[row] ; entry < offsets[row + 1u] ; ++entry) {
+          sum += m_jacobian[entry] * m_vector[columns[entry]];
+        }
+
+        m_product[row] = sum;
+        norm += sum * sum;
+      }
+
+      // The vector is normalized so the norm of the product is the
+      // current estimation of the radius.
+      radius = std::sqrt(norm);
+      if (radius == 0.0f || !std::isfinite(radius)) {
+        break;
+      }
+
+      for (unsigned id = 0u ; id < n ; ++id) {
+        m_vector[id] = m_product[id] / radius;
+      }
+    }
+
+    return (std::isfinite(radius) ? radius : std::numeric_limits<float>::max());
+  }
+
+}
@@ -0,0 +1,838 @@
+#ifndef    INTEGRATORS_HH
+# define   INTEGRATORS_HH
+
+# include <vector>
+# include <cstddef>
+# include "CompiledSystem.hh"
+# include "IterationMatrix.hh"
+
+namespace eqdif {
+
+  /// @brief - Each integrator exposes the same interface which
+  /// is used by the `Model` through static dispatch:
+  ///   void step(const CompiledSystem& system,
+  ///             const float* in,
+  ///             float* out,
+  ///             float dt);
+  /// It computes in `out` the values of all the variables after
+  /// `dt` seconds starting from `in`. The integrators own the
+  /// buffers they need for the intermediate stages and allocate
+  /// them only once when they are created.
+  ///
+  /// Adaptive integrators may internally use steps which differ
+  /// from `dt`: they still produce the values after exactly `dt`
+  /// seconds by interpolating them.
+  ///
+  /// Once a step is computed, the `Model` bounds its values with:
+  ///   void clamp(const CompiledSystem& system,
+  ///              const std::vector<Range>& ranges,
+  ///              float* out) noexcept;
+  /// The integrators which continue from their internal state also
+  /// bound it there, so that the next step starting from the bounded
+  /// values is recognized as the continuation of the previous one.
+
+  /// @brief - The error allowed on each step of the adaptive
+  /// integrators. The error of a variable is compared to
+  /// `absolute + relative * |value|`.
+  struct Tolerance {
+    /// @brief - The part of the allowed error which does not depend
+    /// on the value of the variable.
+    float absolute;
+
+    /// @brief - The part of the allowed error proportional to the
+    /// value of the variable.
+    float relative;
+  };
+
+  /**
+   * @brief - Generate the default tolerance of adaptive integrators.
+   * @return - the tolerance.
+   */
+  Tolerance
+  defaultTolerance() noexcept;
+
+  /**
+   * @brief - Bound the input values to the ranges of the variables.
+   * @param ranges - the bounds of each variable.
+   * @param values - the values to bound.
+   * @return - `true` if at least one value was changed.
+   */
+  bool
+  clampToRanges(const std::vector<Range>& ranges, float* values) noexcept;
+
+  class EulerIntegrator {
+    public:
+
+      /**
+       * @brief - Create a new integrator for a system with the
+       *          specified number of variables.
+       * @param size - the number of variables of the system.
+       */
+      explicit
+      EulerIntegrator(unsigned size);
+
+      /**
+       * @brief - Advance the system by a single step.
+       * @param system - the system to integrate.
+       * @param in - the current values of the variables.
+       * @param out - output array for the next values.
+       * @param dt - the duration of the step.
+       */
+      void
+      step(const CompiledSystem& system,
+           const float* in,
+           float* out,
+           float dt) noexcept;
+
+      /**
+       * @brief - Bound the values produced by the last step.
+       * @param system - the system to integrate.
+       * @param ranges - the bounds of each variable.
+       * @param out - the values produced by the last step.
+       */
+      void
+      clamp(const CompiledSystem& system,
+            const std::vector<Range>& ranges,
+            float* out) noexcept;
+
+    private:
+
+      /// @brief - The derivatives at the start of the step.
+      std::vector<float> m_k;
+  };
+
+  class RungeKutta4Integrator {
+    public:
+
+      /**
+       * @brief - Create a new integrator for a system with the
+       *          specified number of variables.
+       * @param size - the number of variables of the system.
+       */
+      explicit
+      RungeKutta4Integrator(unsigned size);
+
+      /**
+       * @brief - Advance the system by a single step.
+       * @param system - the system to integrate.
+       * @param in - the current values of the variables.
+       * @param out - output array for the next values.
+       * @param dt - the duration of the step.
+       */
+      void
+      step(const CompiledSystem& system,
+           const float* in,
+           float* out,
+           float dt) noexcept;
+
+      /**
+       * @brief - Advance the system by a single step, reusing the
+       *          derivatives already computed at the current values.
+       * @param system - the system to integrate.
+       * @param in - the current values of the variables.
+       * @param k1 - the derivatives at the current values.
+       * @param out - output array for the next values.
+       * @param dt - the duration of the step.
+       */
+      void
+      step(const CompiledSystem& system,
+           const float* in,
+           const float* k1,
+           float* out,
+           float dt) noexcept;
+
+      /**
+       * @brief - Bound the values produced by the last step.
+       * @param system - the system to integrate.
+       * @param ranges - the bounds of each variable.
+       * @param out - the values produced by the last step.
+       */
+      void
+      clamp(const CompiledSystem& system,
+            const std::vector<Range>& ranges,
+            float* out) noexcept;
+
+    private:
+
+      /// @brief - The derivatives computed at each stage.
+      std::vector<float> m_k1;
+      std::vector<float> m_k2;
+      std::vector<float> m_k3;
+      std::vector<float> m_k4;
+
+      /// @brief - The state at which the next stage is evaluated.
+      std::vector<float> m_tmp;
+  };
+
+  /// @brief - The adaptive Runge-Kutta method of Dormand and Prince,
+  /// of order 5 with an embedded solution of order 4 to estimate the
+  /// error of each step. The duration of the internal steps follows
+  /// the error: large steps are taken when the variables evolve
+  /// smoothly and small ones near transients. The values at the end
+  /// of each requested step are interpolated with the dense output
+  /// of the method, so the internal steps are independent of `dt`.
+  ///
+  /// The last stage of a step is the first one of the next step and
+  /// is reused (FSAL). The integrator keeps its internal state from
+  /// one call to the next as long as the input values are the ones
+  /// it produced: otherwise (e.g. when the simulation was reset) the
+  /// integration restarts from the input values. When a variable is
+  /// clamped, the end of the last accepted step is clamped as well so
+  /// that the integration continues with the same step size, and the
+  /// variable is interpolated linearly over the rest of the step so
+  /// that it stays within its range.
+  class DormandPrince45Integrator {
+    public:
+
+      /**
+       * @brief - Create a new integrator for a system with the
+       *          specified number of variables.
+       * @param size - the number of variables of the system.
+       * @param tolerance - the error allowed on each step.
+       */
+      explicit
+      DormandPrince45Integrator(unsigned size,
+                                const Tolerance& tolerance = defaultTolerance());
+
+      /**
+       * @brief - Advance the system by a single step.
+       * @param system - the system to integrate.
+       * @param in - the current values of the variables.
+       * @param out - output array for the next values.
+       * @param dt - the duration of the step.
+       */
+      void
+      step(const CompiledSystem& system,
+           const float* in,
+           float* out,
+           float dt) noexcept;
+
+      /**
+       * @brief - Bound the values produced by the last step.
+       * @param system - the system to integrate.
+       * @param ranges - the bounds of each variable.
+       * @param out - the values produced by the last step.
+       */
+      void
+      clamp(const CompiledSystem& system,
+            const std::vector<Range>& ranges,
+            float* out) noexcept;
+
+      /**
+       * @brief - The size of the next internal step.
+       * @return - the step size.
+       */
+      float
+      stepSize() const noexcept;
+
+      /**
+       * @brief - The number of evaluations of the derivatives since
+       *          the integrator was created.
+       * @return - the number of evaluations.
+       */
+      std::size_t
+      evaluations() const noexcept;
+
+      /**
+       * @brief - The number of internal steps rejected because their
+       *          error was too large since the integrator was created.
+       * @return - the number of rejected steps.
+       */
+      std::size_t
+      rejections() const noexcept;
+
+    private:
+
+      /**
+       * @brief - Restart the integration from the input values.
+       * @param system - the system to integrate.
+       * @param in - the values of the variables.
+       */
+      void
+      restart(const CompiledSystem& system, const float* in) noexcept;
+
+      /**
+       * @brief - Attempt an internal step from the end of the last
+       *          accepted one, with the current step size. The size
+       *          is then adapted to the estimated error.
+       * @param system - the system to integrate.
+       * @param minimum - the smallest step size allowed: a step of
+       *                  this size is always accepted.
+       * @return - `true` if the step was accepted.
+       */
+      bool
+      attempt(const CompiledSystem& system, float minimum) noexcept;
+
+      /**
+       * @brief - Interpolate the values of the variables within the
+       *          last accepted internal step.
+       * @param t - the time at which the values are computed. It
+       *            should lie within the last accepted step.
+       * @param out - output array for the values.
+       */
+      void
+      interpolate(double t, float* out) const noexcept;
+
+    private:
+
+      /// @brief - The number of variables of the system.
+      unsigned m_size;
+
+      /// @brief - The error allowed on each step.
+      Tolerance m_tolerance;
+
+      /// @brief - Whether an integration is in progress, `false`
+      /// until the first step and after a restart is needed.
+      bool m_started;
+
+      /// @brief - The time of the last produced values.
+      double m_time;
+
+      /// @brief - The start and end time of the last accepted step.
+      double m_start;
+      double m_end;
+
+      /// @brief - The size of the next internal step.
+      float m_h;
+
+      /// @brief - The error of the last accepted step, used by the
+      /// step size controller.
+      float m_previousError;
+
+      /// @brief - Whether the last attempted step was rejected: the
+      /// step size is then not allowed to grow.
+      bool m_rejected;
+
+      /// @brief - The number of evaluations of the derivatives.
+      std::size_t m_evaluations;
+
+      /// @brief - The number of rejected steps.
+      std::size_t m_rejections;
+
+      /// @brief - The values of the variables at the end of the last
+      /// accepted step.
+      std::vector<float> m_y;
+
+      /// @brief - The values computed by the step being attempted.
+      std::vector<float> m_next;
+
+      /// @brief - The last produced values, to detect whether the
+      /// integration can continue from them.
+      std::vector<float> m_last;
+
+      /// @brief - The derivatives computed at each stage. The last
+      /// stage is evaluated at the end of the step.
+      std::vector<float> m_k1;
+      std::vector<float> m_k2;
+      std::vector<float> m_k3;
+      std::vector<float> m_k4;
+      std::vector<float> m_k5;
+      std::vector<float> m_k6;
+      std::vector<float> m_k7;
+
+      /// @brief - The state at which the next stage is evaluated.
+      std::vector<float> m_tmp;
+
+      /// @brief - The coefficients of the interpolating polynomial
+      /// over the last accepted step.
+      std::vector<float> m_dense;
+  };
+
+  /// @brief - The two stages linearly implicit Rosenbrock method of
+  /// order 2 from Verwer et al. It is L-stable so large steps can be
+  /// taken on stiff systems, and only needs to solve linear systems
+  /// with the iteration matrix rather than to iterate.
+  ///
+  /// The method keeps its order with an approximate Jacobian (it is
+  /// a W-method): the Jacobian and the factorization of the matrix
+  /// are thus reused for several steps and only refreshed regularly
+  /// or when the duration of the steps changes.
+  class Rosenbrock2Integrator {
+    public:
+
+      /**
+       * @brief - Create a new integrator for the input system.
+       * @param system - the system to integrate, used for the
+       *                 structure of its Jacobian.
+       */
+      explicit
+      Rosenbrock2Integrator(const CompiledSystem& system);
+
+      /**
+       * @brief - Advance the system by a single step.
+       * @param system - the system to integrate.
+       * @param in - the current values of the variables.
+       * @param out - output array for the next values.
+       * @param dt - the duration of the step.
+       */
+      void
+      step(const CompiledSystem& system,
+           const float* in,
+           float* out,
+           float dt) noexcept;
+
+      /**
+       * @brief - Bound the values produced by the last step.
+       * @param system - the system to integrate.
+       * @param ranges - the bounds of each variable.
+       * @param out - the values produced by the last step.
+       */
+      void
+      clamp(const CompiledSystem& system,
+            const std::vector<Range>& ranges,
+            float* out) noexcept;
+
+      /**
+       * @brief - Make sure that the Jacobian is computed again for
+       *          the next step.
+       */
+      void
+      refresh() noexcept;
+
+    private:
+
+      /// @brief - The number of steps since the Jacobian was last
+      /// computed.
+      unsigned m_age;
+
+      /// @brief - The non-zero entries of the Jacobian.
+      std::vector<float> m_jacobian;
+
+      /// @brief - The iteration matrix and its factorization.
+      IterationMatrix m_matrix;
+
+      /// @brief - The solution of each stage.
+      std::vector<float> m_k1;
+      std::vector<float> m_k2;
+
+      /// @brief - The state at which the second stage is evaluated.
+      std::vector<float> m_tmp;
+  };
+
+  /// @brief - The backward differentiation formula of order 2. The
+  /// values at the end of the step are the solution of a non-linear
+  /// system which is solved with a simplified Newton iteration: the
+  /// factorization of the iteration matrix is kept from one step to
+  /// the next and the Jacobian is only refreshed when the iteration
+  /// does not converge.
+  ///
+  /// The method needs the values of the previous step: as for the
+  /// adaptive integrators, they are only used when the input values
+  /// are the ones produced (and clamped) by the integrator and the
+  /// duration of the step did not change. Otherwise a step of the
+  /// implicit Euler method (the BDF of order 1) is taken.
+  class Bdf2Integrator {
+    public:
+
+      /**
+       * @brief - Create a new integrator for the input system.
+       * @param system - the system to integrate, used for the
+       *                 structure of its Jacobian.
+       * @param tolerance - the error allowed when solving for the
+       *                    values at the end of each step.
+       */
+      Bdf2Integrator(const CompiledSystem& system,
+                     const Tolerance& tolerance = defaultTolerance());
+
+      /**
+       * @brief - Advance the system by a single step.
+       * @param system - the system to integrate.
+       * @param in - the current values of the variables.
+       * @param out - output array for the next values.
+       * @param dt - the duration of the step.
+       */
+      void
+      step(const CompiledSystem& system,
+           const float* in,
+           float* out,
+           float dt) noexcept;
+
+      /**
+       * @brief - Bound the values produced by the last step.
+       * @param system - the system to integrate.
+       * @param ranges - the bounds of each variable.
+       * @param out - the values produced by the last step.
+       */
+      void
+      clamp(const CompiledSystem& system,
+            const std::vector<Range>& ranges,
+            float* out) noexcept;
+
+    private:
+
+      /**
+       * @brief - Solve for the values at the end of the step with the
+       *          simplified Newton iteration, starting from the values
+       *          in `out`.
+       * @param system - the system to integrate.
+       * @param gamma - the factor applied to the derivatives.
+       * @param out - the initial guess, replaced by the solution.
+       * @return - `true` if the iteration converged.
+       */
+      bool
+      solve(const CompiledSystem& system, float gamma, float* out) noexcept;
+
+    private:
+
+      /// @brief - The number of variables of the system.
+      unsigned m_size;
+
+      /// @brief - The error allowed on the solution of each step.
+      Tolerance m_tolerance;
+
+      /// @brief - Whether the previous values are available.
+      bool m_started;
+
+      /// @brief - The duration of the last step.
+      float m_dt;
+
+      /// @brief - Whether the Jacobian was computed for the current
+      /// step, in which case refreshing it will not help.
+      bool m_fresh;
+
+      /// @brief - The non-zero entries of the Jacobian.
+      std::vector<float> m_jacobian;
+
+      /// @brief - The iteration matrix and its factorization.
+      IterationMatrix m_matrix;
+
+      /// @brief - The values at the start of the previous step.
+      std::vector<float> m_previous;
+
+      /// @brief - The last produced values, to detect whether the
+      /// integration can continue from them.
+      std::vector<float> m_last;
+
+      /// @brief - The constant part of the equation of the step,
+      /// built from the past values.
+      std::vector<float> m_base;
+
+      /// @brief - The derivatives at the current guess.
+      std::vector<float> m_f;
+
+      /// @brief - The correction of the current guess.
+      std::vector<float> m_delta;
+  };
+
+  /// @brief - The velocity Verlet method, which handles second order
+  /// equations natively: their variables are the positions and their
+  /// equations give the accelerations, while the velocities are kept
+  /// by the integrator rather than being added to the variables as a
+  /// reduction to first order would do. The system is evaluated once
+  /// per step as the accelerations at the end of a step are reused
+  /// at the start of the next one. The method is symplectic, so the
+  /// energy of oscillators does not drift over long runs.
+  ///
+  /// First order equations are integrated alongside with Heun's
+  /// method, reusing the same evaluations.
+  ///
+  /// The velocities start at zero, unless the values of the previous
+  /// step are provided with `seed`. When the input values are not the
+  /// ones produced by the integrator (e.g. when a variable is clamped)
+  /// the velocity of the variables which changed is reset.
+  class VelocityVerletIntegrator {
+    public:
+
+      /**
+       * @brief - Create a new integrator for the input system.
+       * @param system - the system to integrate, used for the order
+       *                 of its equations.
+       */
+      explicit
+      VelocityVerletIntegrator(const CompiledSystem& system);
+
+      /**
+       * @brief - Provide the values of the step preceding the first
+       *          one to integrate: the initial velocities are derived
+       *          from them.
+       * @param previous - the values of the previous step.
+       */
+      void
+      seed(const float* previous);
+
+      /**
+       * @brief - Advance the system by a single step.
+       * @param system - the system to integrate.
+       * @param in - the current values of the variables.
+       * @param out - output array for the next values.
+       * @param dt - the duration of the step.
+       */
+      void
+      step(const CompiledSystem& system,
+           const float* in,
+           float* out,
+           float dt) noexcept;
+
+      /**
+       * @brief - Bound the values produced by the last step.
+       * @param system - the system to integrate.
+       * @param ranges - the bounds of each variable.
+       * @param out - the values produced by the last step.
+       */
+      void
+      clamp(const CompiledSystem& system,
+            const std::vector<Range>& ranges,
+            float* out) noexcept;
+
+    private:
+
+      /**
+       * @brief - Restart the integration from the input values.
+       * @param system - the system to integrate.
+       * @param in - the values of the variables.
+       * @param dt - the duration of the step.
+       */
+      void
+      restart(const CompiledSystem& system, const float* in, float dt) noexcept;
+
+    private:
+
+      /// @brief - The number of variables of the system.
+      unsigned m_size;
+
+      /// @brief - Whether each equation is of second order.
+      std::vector<bool> m_secondOrder;
+
+      /// @brief - Whether an integration is in progress.
+      bool m_started;
+
+      /// @brief - Whether the values of the previous step were given
+      /// to derive the velocities.
+      bool m_seeded;
+
+      /// @brief - The values of the previous step, if seeded.
+      std::vector<float> m_previous;
+
+      /// @brief - The velocity of the variables of second order.
+      std::vector<float> m_velocities;
+
+      /// @brief - The derivatives at the start of the step.
+      std::vector<float> m_f;
+
+      /// @brief - The derivatives at the end of the step.
+      std::vector<float> m_next;
+
+      /// @brief - The last produced values, to detect whether the
+      /// integration can continue from them.
+      std::vector<float> m_last;
+  };
+
+  /// @brief - The number of past derivatives used by the Adams
+  /// methods, which is also their order.
+  constexpr auto ADAMS_ORDER = 4u;
+
+  /// @brief - The Adams-Bashforth-Moulton predictor-corrector method
+  /// of order 4. The values at the end of the step are predicted by
+  /// the explicit Adams-Bashforth formula and corrected once by the
+  /// implicit Adams-Moulton formula, each one evaluating the system
+  /// once: this is much cheaper than the four evaluations of RK4 as
+  /// the derivatives of the past steps are reused.
+  ///
+  /// The past derivatives are kept in a fixed-size ring buffer. The
+  /// derivatives of a step are computed at its start, i.e. once its
+  /// input values were clamped by the model. They are only used when
+  /// the input values are the ones produced (and clamped) by the
+  /// integrator and the duration of the step did not change, which is
+  /// the case as long as the simulation is not reset or loaded (and
+  /// the model rebuilt). Otherwise the history is started again from
+  /// the input values, using RK4 for the first steps.
+  class AdamsBashforthMoultonIntegrator {
+    public:
+
+      /**
+       * @brief - Create a new integrator for a system with the
+       *          specified number of variables.
+       * @param size - the number of variables of the system.
+       */
+      explicit
+      AdamsBashforthMoultonIntegrator(unsigned size);
+
+      /**
+       * @brief - Advance the system by a single step.
+       * @param system - the system to integrate.
+       * @param in - the current values of the variables.
+       * @param out - output array for the next values.
+       * @param dt - the duration of the step.
+       */
+      void
+      step(const CompiledSystem& system,
+           const float* in,
+           float* out,
+           float dt) noexcept;
+
+      /**
+       * @brief - Bound the values produced by the last step.
+       * @param system - the system to integrate.
+       * @param ranges - the bounds of each variable.
+       * @param out - the values produced by the last step.
+       */
+      void
+      clamp(const CompiledSystem& system,
+            const std::vector<Range>& ranges,
+            float* out) noexcept;
+
+    private:
+
+      /**
+       * @brief - Access the derivatives of a past step.
+       * @param age - the age of the step, `0` being the most recent.
+       * @return - the derivatives of the step.
+       */
+      const float*
+      derivatives(unsigned age) const noexcept;
+
+      /**
+       * @brief - Compute the derivatives of the input values and add
+       *          them to the history, replacing the oldest ones.
+       * @param system - the system to integrate.
+       * @param values - the values of the variables.
+       */
+      void
+      push(const CompiledSystem& system, const float* values) noexcept;
+
+    private:
+
+      /// @brief - The number of variables of the system.
+      unsigned m_size;
+
+      /// @brief - The integrator used for the first steps.
+      RungeKutta4Integrator m_bootstrap;
+
+      /// @brief - The duration of the last step.
+      float m_dt;
+
+      /// @brief - The derivatives of the last `ADAMS_ORDER` steps.
+      std::vector<float> m_history;
+
+      /// @brief - The slot of the history holding the derivatives of
+      /// the most recent step.
+      unsigned m_head;
+
+      /// @brief - The number of valid steps in the history.
+      unsigned m_count;
+
+      /// @brief - The last produced values, to detect whether the
+      /// integration can continue from them.
+      std::vector<float> m_last;
+
+      /// @brief - The predicted values at the end of the step.
+      std::vector<float> m_predicted;
+
+      /// @brief - The derivatives at the predicted values.
+      std::vector<float> m_f;
+  };
+
+  /// @brief - Selects the integrator at run time from the stiffness
+  /// of the system, in the spirit of `LSODA`: the adaptive explicit
+  /// Dormand-Prince method is used as long as its steps are limited
+  /// by the accuracy, and the Rosenbrock method when they are limited
+  /// by the stability, i.e. when the system is stiff.
+  ///
+  /// The stiffness is checked regularly by estimating the spectral
+  /// radius of the Jacobian with a few power iterations. With the
+  /// explicit method, the system is considered stiff when its steps
+  /// are close to the stability limit and it needs more evaluations
+  /// than the implicit method would. With the implicit method, the
+  /// number of evaluations the explicit method would need to stay
+  /// stable is predicted from the spectral radius. A margin avoids
+  /// switching back and forth.
+  ///
+  /// Second order equations are not handled: the model rather uses
+  /// the velocity Verlet method for systems which include some.
+  class AutomaticIntegrator {
+    public:
+
+      /**
+       * @brief - Create a new integrator for the input system.
+       * @param system - the system to integrate.
+       * @param tolerance - the error allowed on each step of the
+       *                    explicit method.
+       */
+      AutomaticIntegrator(const CompiledSystem& system,
+                          const Tolerance& tolerance = defaultTolerance());
+
+      /**
+       * @brief - Advance the system by a single step.
+       * @param system - the system to integrate.
+       * @param in - the current values of the variables.
+       * @param out - output array for the next values.
+       * @param dt - the duration of the step.
+       */
+      void
+      step(const CompiledSystem& system,
+           const float* in,
+           float* out,
+           float dt) noexcept;
+
+      /**
+       * @brief - Bound the values produced by the last step.
+       * @param system - the system to integrate.
+       * @param ranges - the bounds of each variable.
+       * @param out - the values produced by the last step.
+       */
+      void
+      clamp(const CompiledSystem& system,
+            const std::vector<Range>& ranges,
+            float* out) noexcept;
+
+      /**
+       * @brief - Whether the system is currently considered stiff and
+       *          integrated with the implicit method.
+       * @return - `true` if the implicit method is used.
+       */
+      bool
+      stiff() const noexcept;
+
+    private:
+
+      /**
+       * @brief - Decide which method should be used from the current
+       *          stiffness of the system.
+       * @param system - the system to integrate.
+       * @param in - the current values of the variables.
+       * @param dt - the duration of the steps.
+       */
+      void
+      select(const CompiledSystem& system, const float* in, float dt) noexcept;
+
+      /**
+       * @brief - Estimate the spectral radius of the Jacobian of the
+       *          system with a few power iterations.
+       * @param system - the system to integrate.
+       * @param in - the values at which the Jacobian is computed.
+       * @return - the estimated spectral radius.
+       */
+      float
+      spectralRadius(const CompiledSystem& system, const float* in) noexcept;
+
+    private:
+
+      /// @brief - The explicit method, used for non-stiff systems.
+      DormandPrince45Integrator m_explicit;
+
+      /// @brief - The implicit method, used for stiff systems.
+      Rosenbrock2Integrator m_implicit;
+
+      /// @brief - Whether the implicit method is used.
+      bool m_stiff;
+
+      /// @brief - The number of steps since the stiffness was last
+      /// checked.
+      unsigned m_steps;
+
+      /// @brief - The number of evaluations and rejections of the
+      /// explicit method when the stiffness was last checked.
+      std::size_t m_evaluations;
+      std::size_t m_rejections;
+
+      /// @brief - The non-zero entries of the Jacobian.
+      std::vector<float> m_jacobian;
+
+      /// @brief - The vectors of the power iteration.
+      std::vector<float> m_vector;
+      std::vector<float> m_product;
+  };
+
+}
+
+#endif    /* INTEGRATORS_HH */
@@ -0,0 +1,125 @@
+
+# include "IterationMatrix.hh"
+# include <cmath>
+# include <algorithm>
+
+namespace eqdif {
+
+  IterationMatrix::IterationMatrix(unsigned size):
+    m_size(size),
+    m_gamma(0.0f),
+    m_factorized(false),
+
+    m_lu(size * size, 0.0f),
+    m_pivots(size, 0u)
+  {}
+
+  bool
+  IterationMatrix::factorized() const noexcept {
+    return m_factorized;
+  }
+
+  float
+  IterationMatrix::gamma() const noexcept {
+    return m_gamma;
+  }
+
+  void
+  IterationMatrix::invalidate() noexcept {
+    m_factorized = false;
+  }
+
+  bool
+  IterationMatrix::factorize(const CompiledSystem& system,
+                             const float* jacobian,
+                             float gamma) noexcept
+  {
+    const unsigned n = m_size;
+    m_gamma = gamma;
+
+    // Scatter the sparse Jacobian in the dense storage.
+    std::fill(m_lu.begin(), m_lu.end(), 0.0f);
+    for (unsigned row = 0u ; row < n ; ++row) {
+      m_lu[row * n + row] = 1.0f;
+    }
+
+    const std::vector<unsigned>& offsets = system.jacobianOffsets();
+    const std::vector<unsigned>& columns = system.jacobianColumns();
+    for (unsigned row = 0u ; row < n ; ++row) {
+      for (unsigned entry = offsets[row] ; entry < offsets[row + 1u] ; ++entry) {
+        m_lu[row * n + columns[entry]] -= gamma * jacobian[entry];
+      }
+    }
+
+    // https://en.wikipedia.org/wiki/LU_decomposition
+    // Doolittle algorithm with partial pivoting, in place.
+    for (unsigned col = 0u ; col < n ; ++col) {
+      unsigned pivot = col;
+      for (unsigned row = col + 1u ; row < n ; ++row) {
+        if (std::abs(m_lu[row * n + col]) > std::abs(m_lu[pivot * n + col])) {
+          pivot = row;
+        }
+      }
+
+      m_pivots[col] = pivot;
+      if (m_lu[pivot * n + col] == 0.0f || !std::isfinite(m_lu[pivot * n + col])) {
+        m_factorized = false;
+        return false;
+      }
+
+      if (pivot != col) {
+        std::swap_ranges(m_lu.begin() + col * n, m_lu.begin() + (col + 1u) * n, m_lu.begin() + pivot * n);
+      }
+
+      const float inverse = 1.0f / m_lu[col * n + col];
+      for (unsigned row = col + 1u ; row < n ; ++row) {
+        float* line = m_lu.data() + row * n;
+        const float factor = line[col] * inverse;
+        line[col] = factor;
+
+        if (factor == 0.0f) {
+          continue;
+        }
+
+        const float* top = m_lu.data() + col * n;
+        for (unsigned id = col + 1u ; id < n ; ++id) {
+          line[id] -= factor * top[id];
+        }
+      }
+    }
+
+    m_factorized = true;
+    return true;
+  }
+
+  void
+  IterationMatrix::solve(float* rhs) const noexcept {
+    const unsigned n = m_size;
+
+    // Apply the permutation and the forward substitution with `L`.
+    for (unsigned row = 0u ; row < n ; ++row) {
+      std::swap(rhs[row], rhs[m_pivots[row]]);
+    }
+
+    for (unsigned row = 1u ; row < n ; ++row) {
+      const float* line = m_lu.data() + row * n;
+      float sum = rhs[row];
+      for (unsigned id = 0u ; id < row ; ++id) {
+        sum -= line[id] * rhs[id];
+      }
+      rhs[row] = sum;
+    }
+
+    // Backward substitution with `U`.
+    for (unsigned row = n ; row > 0u ; --row) {
+      const unsigned r = row - 1u;
+      const float* line = m_lu.data() + r * n;
+      float sum = rhs[r];
+      for (unsigned id = r + 1u ; id < n ; ++id) {
+        sum -= line[id] * rhs[id];
+      }
+      rhs[r] = sum / line[r];
+    }
+  }
+
+}
@@ -0,0 +1,98 @@
+#ifndef    ITERATION_MATRIX_HH
+# define   ITERATION_MATRIX_HH
+
+# include <vector>
+# include "CompiledSystem.hh"
+
+namespace eqdif {
+
+  /// @brief - The matrix `I - gamma * J` used by the implicit
+  /// integrators, where `J` is the Jacobian of the system, along
+  /// with its LU factorization. The factorization is the expensive
+  /// part: it is kept and reused to solve as many linear systems as
+  /// needed until either the Jacobian or `gamma` changes.
+  ///
+  /// The Jacobian is provided in the sparse form computed by the
+  /// `CompiledSystem`. The factors are stored densely with partial
+  /// pivoting: the systems we simulate only have a few tens of
+  /// variables and the fill-in of the factorization would make
+  /// most of them dense anyway.
+  class IterationMatrix {
+    public:
+
+      /**
+       * @brief - Create a new matrix for a system with the specified
+       *          number of variables. Nothing is factorized yet.
+       * @param size - the number of variables of the system.
+       */
+      explicit
+      IterationMatrix(unsigned size);
+
+      /**
+       * @brief - Whether a factorization is available to solve the
+       *          linear systems.
+       * @return - `true` if the matrix is factorized.
+       */
+      bool
+      factorized() const noexcept;
+
+      /**
+       * @brief - The value of `gamma` used by the last factorization.
+       * @return - the factor applied to the Jacobian.
+       */
+      float
+      gamma() const noexcept;
+
+      /**
+       * @brief - Discard the factorization, e.g. because the Jacobian
+       *          is out of date.
+       */
+      void
+      invalidate() noexcept;
+
+      /**
+       * @brief - Build the matrix `I - gamma * J` and factorize it.
+       * @param system - the system from which the Jacobian is taken,
+       *                 used for its sparse structure.
+       * @param jacobian - the non-zero entries of the Jacobian.
+       * @param gamma - the factor applied to the Jacobian.
+       * @return - `false` if the matrix is singular, in which case
+       *           no factorization is available.
+       */
+      bool
+      factorize(const CompiledSystem& system,
+                const float* jacobian,
+                float gamma) noexcept;
+
+      /**
+       * @brief - Solve the linear system `(I - gamma * J) x = b` with
+       *          the last factorization, which should be available.
+       * @param rhs - the right hand side `b`, replaced by the solution.
+       */
+      void
+      solve(float* rhs) const noexcept;
+
+    private:
+
+      /// @brief - The number of variables of the system.
+      unsigned m_size;
+
+      /// @brief - The factor applied to the Jacobian by the last
+      /// factorization.
+      float m_gamma;
+
+      /// @brief - Whether the factors are valid.
+      bool m_factorized;
+
+      /// @brief - The `L` and `U` factors, row by row. The diagonal
+      /// of `L` is implicitly made of ones.
+      std::vector<float> m_lu;
+
+      /// @brief - The row swapped with each row during the
+      /// factorization.
+      std::vector<unsigned> m_pivots;
+  };
+
+}
+
+#endif    /* ITERATION_MATRIX_HH */
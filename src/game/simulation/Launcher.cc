@@ -1,11 +1,12 @@
 
 # include "Launcher.hh"
+# include <cmath>
+# include <algorithm>
 # include <core_utils/TimeUtils.hh>
 
-/// @brief - The minimum duration for which we will sleep
-/// in case the processing of a simulation step is short
-/// enough to consider sleeping.
-# define MINIMUM_SLEEP_TIME 3
+/// @brief - The maximum number of late frames computed
+/// in a burst with the default pacing policy.
+# define DEFAULT_MAX_LATE_FRAMES 8
 
 using namespace std::chrono_literals;
 
@@ -35,6 +36,15 @@ namespace eqdif {
     }
   }
 
+  PacingPolicy
+  defaultPacingPolicy() noexcept {
+    return PacingPolicy{
+      CatchUp::Burst,          // catchUp
+      DEFAULT_MAX_LATE_FRAMES, // maxLateFrames
+      utils::Duration::zero()  // spin
+    };
+  }
+
   Launcher::Launcher(Process* process,
                      float fps,
                      float step,
@@ -44,14 +54,24 @@ namespace eqdif {
     m_process(process),
 
     m_simThreadLocker(),
+    m_processLocker(),
+    m_stateNotifier(),
     m_simThread(nullptr),
     m_state(State::None),
 
     m_desiredFPS(fps),
+    m_stepsPerFrame(1u),
     m_step(step),
     m_stepUnit(unit),
 
-    m_time(0.0f, m_stepUnit)
+    m_time(0.0f, m_stepUnit),
+
+    m_pacing(defaultPacingPolicy()),
+    m_deadline(utils::now()),
+    m_statisticsStart(m_deadline),
+    m_frames(0u),
+    m_overruns(0u),
+    m_dropped(0u)
   {
     setService("eqdif");
   }
@@ -86,9 +106,74 @@ namespace eqdif {
     Guard guard(m_simThreadLocker);
     m_desiredFPS = fps;
 
+    // The statistics are only meaningful for a single rate.
+    resetStatistics();
+
     info("Setting desired framerate to " + std::to_string(static_cast<int>(m_desiredFPS)));
   }
 
+  void
+  Launcher::setTimeRate(float rate) {
+    if (rate <= 0.0f) {
+      warn(
+        "Failed to set time rate to " + std::to_string(rate),
+        "Invalid value"
+      );
+
+      return;
+    }
+
+    Guard guard(m_simThreadLocker);
+
+    // Each frame advances the simulated time by a whole number of
+    // steps: pick the closest rate that can be achieved.
+    const float perFrame = m_desiredFPS * time::convertDuration(m_step, m_stepUnit, time::Unit::Second);
+    m_stepsPerFrame = std::max(static_cast<unsigned>(std::round(rate / perFrame)), 1u);
+
+    resetStatistics();
+
+    info(
+      "Setting time rate to " + std::to_string(m_stepsPerFrame * perFrame) + " (" +
+      std::to_string(m_stepsPerFrame) + " step(s) per frame)"
+    );
+  }
+
+  float
+  Launcher::timeRate() const noexcept {
+    Guard guard(m_simThreadLocker);
+    return m_stepsPerFrame * m_desiredFPS * time::convertDuration(m_step, m_stepUnit, time::Unit::Second);
+  }
+
+  unsigned
+  Launcher::stepsPerFrame() const noexcept {
+    Guard guard(m_simThreadLocker);
+    return m_stepsPerFrame;
+  }
+
+  void
+  Launcher::setPacingPolicy(const PacingPolicy& policy) {
+    Guard guard(m_simThreadLocker);
+    m_pacing = policy;
+  }
+
+  RateStatistics
+  Launcher::rateStatistics() const noexcept {
+    Guard guard(m_simThreadLocker);
+
+    const float elapsed = std::chrono::duration<float>(utils::now() - m_statisticsStart).count();
+    const float step = time::convertDuration(m_step, m_stepUnit, time::Unit::Second);
+
+    return RateStatistics{
+      m_desiredFPS,                                  // desired
+      (elapsed > 0.0f ? m_frames / elapsed : 0.0f), // achieved
+      m_frames,                                      // frames
+      m_overruns,                                    // overruns
+      m_dropped,                                     // dropped
+      m_stepsPerFrame,                               // stepsPerFrame
+      m_stepsPerFrame * m_desiredFPS * step          // timeRate
+    };
+  }
+
   void
   Launcher::start() {
     Guard guard(m_simThreadLocker);
@@ -107,6 +192,7 @@ namespace eqdif {
     Guard guard(m_simThreadLocker);
     if (m_state == State::Running) {
       m_state = State::PauseRequested;
+      m_stateNotifier.notify_one();
     }
   }
 
@@ -115,6 +201,7 @@ namespace eqdif {
     Guard guard(m_simThreadLocker);
     if (m_state == State::Paused) {
       m_state = State::ResumeRequested;
+      m_stateNotifier.notify_one();
     }
   }
 
@@ -139,6 +226,7 @@ namespace eqdif {
 
     m_state = State::StopRequested;
     m_simThreadLocker.unlock();
+    m_stateNotifier.notify_one();
 
     // Wait for the thread to terminate.
     m_simThread->join();
@@ -173,13 +261,18 @@ namespace eqdif {
     }
 
     info("Performing single simulation step");
-    simulate(false, m_desiredFPS);
+    simulate(false, m_desiredFPS, 1u, m_pacing);
   }
 
   void
   Launcher::performOperation(LockedOperation op) const {
     Guard guard(m_simThreadLocker);
 
+    // The simulation thread does not hold the locker while it
+    // computes steps: wait for the current frame to be done so
+    // that the operation does not access the process concurrently.
+    Guard process(m_processLocker);
+
     withSafetyNet(
       [&op, this]() {
         op(*m_process);
@@ -201,58 +294,74 @@ namespace eqdif {
     {
       Guard guard(m_simThreadLocker);
       m_state = State::Running;
+      restartSchedule();
     }
 
     // Run simulation steps
     bool done = false;
     while (!done) {
       // Handle stop, pause and resume requests. Note that
-      // we can't use a lock guard as we may potentially
-      // sleep for a bit in the `simulate` method so we
-      // release the lock to allow other processes to modify
-      // the internal values.
-      m_simThreadLocker.lock();
+      // we can't hold the lock for the whole iteration as
+      // we may potentially sleep for a bit in the `simulate`
+      // method so we release it to allow other processes to
+      // modify the internal values.
+      UniqueGuard guard(m_simThreadLocker);
 
       switch (m_state) {
         case State::PauseRequested:
           info("Pausing environment simulation");
           m_state = State::Paused;
-          m_simThreadLocker.unlock();
           break;
         case State::ResumeRequested:
           info("Resuming environment simulation");
           m_state = State::Running;
-          m_simThreadLocker.unlock();
+          restartSchedule();
           break;
         case State::StopRequested:
           info("Stopping environment simulation");
           m_state = State::Stopped;
-          m_simThreadLocker.unlock();
           done = true;
           break;
         case State::Running: {
           float desiredFPS = m_desiredFPS;
-          m_simThreadLocker.unlock();
-          simulate(true, desiredFPS);
+          unsigned steps = m_stepsPerFrame;
+          PacingPolicy pacing = m_pacing;
+          guard.unlock();
+          simulate(true, desiredFPS, steps, pacing);
+          } break;
+        default: {
+          // Not handled or nothing to do (e.g. Paused): wait
+          // until the state changes rather than polling it.
+          // Single steps are performed by the caller thread
+          // and do not need to wake up this one.
+          const State current = m_state;
+          m_stateNotifier.wait(
+            guard,
+            [this, current]() {
+              return m_state != current;
+            }
+          );
           } break;
-        default:
-          // Not handled or nothing to do (e.g. Paused).
-          m_simThreadLocker.unlock();
-          break;
       }
     }
   }
 
   void
-  Launcher::simulate(bool sleep, float desiredFPS) {
-    // Update the time manager by one increment.
-    m_time.increment(m_step, m_stepUnit);
-
-    // Simulate the current step.
+  Launcher::simulate(bool sleep,
+                      float desiredFPS,
+                      unsigned steps,
+                      const PacingPolicy& pacing)
+  {
+    // Simulate all the steps of the frame in a row: the time
+    // manager is updated by one increment for each of them.
     utils::TimeStamp s = utils::now();
     withSafetyNet(
-      [this]() {
-        m_process->simulate(m_time);
+      [this, steps]() {
+        Guard guard(m_processLocker);
+        for (unsigned id = 0u ; id < steps ; ++id) {
+          m_time.increment(m_step, m_stepUnit);
+          m_process->simulate(m_time);
+        }
       },
       "simulate"
     );
@@ -261,14 +370,83 @@ namespace eqdif {
     utils::Duration expected = utils::toMilliseconds(1000.0f / desiredFPS);
     if (d > expected) {
       warn("Took " + utils::durationToMsString(d) + " to compute frame, expected " + utils::durationToMsString(expected));
+    }
+
+    // Wait for the next frame if needed.
+    if (sleep) {
+      pace(desiredFPS, pacing);
+    }
+  }
+
+  void
+  Launcher::pace(float desiredFPS, const PacingPolicy& pacing) {
+    // The deadline of each frame is derived from the previous one
+    // rather than from the current time: the time spent to compute
+    // the frame or the latency when waking up do not accumulate.
+    const utils::Duration period = utils::toMilliseconds(1000.0f / desiredFPS);
+    m_deadline += period;
+
+    const utils::TimeStamp now = utils::now();
+    const bool overrun = (now > m_deadline);
+    std::size_t dropped = 0u;
+
+    if (overrun) {
+      const std::size_t late = (now - m_deadline) / period;
+
+      if (pacing.catchUp == CatchUp::Skip) {
+        dropped = late;
+        m_deadline = now;
+      }
+      else if (late > pacing.maxLateFrames) {
+        dropped = late - pacing.maxLateFrames;
+        m_deadline += dropped * period;
+      }
+    }
+
+    UniqueGuard guard(m_simThreadLocker);
+
+    ++m_frames;
+    m_overruns += (overrun ? 1u : 0u);
+    m_dropped += dropped;
+
+    if (overrun) {
+      return;
+    }
+
+    // Sleep until right before the deadline: a change of state
+    // interrupts the wait.
+    m_stateNotifier.wait_until(
+      guard,
+      m_deadline - pacing.spin,
+      [this]() {
+        return m_state != State::Running;
+      }
+    );
+
+    if (m_state != State::Running) {
       return;
     }
 
-    // Wait for a bit if needed.
-    utils::Duration remaining = expected - d;
-    if (sleep && remaining > utils::toMilliseconds(MINIMUM_SLEEP_TIME)) {
-      std::this_thread::sleep_for(remaining);
+    guard.unlock();
+
+    // Busy-wait for the rest of the frame if needed.
+    while (utils::now() < m_deadline) {
+      std::this_thread::yield();
     }
   }
 
+  void
+  Launcher::restartSchedule() {
+    m_deadline = utils::now();
+    resetStatistics();
+  }
+
+  void
+  Launcher::resetStatistics() {
+    m_statisticsStart = utils::now();
+    m_frames = 0u;
+    m_overruns = 0u;
+    m_dropped = 0u;
+  }
+
 }
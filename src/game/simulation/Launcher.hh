@@ -4,7 +4,9 @@
 # include <mutex>
 # include <memory>
 # include <thread>
+# include <condition_variable>
 # include <core_utils/CoreObject.hh>
+# include <core_utils/TimeUtils.hh>
 # include "Manager.hh"
 
 namespace eqdif {
@@ -34,6 +36,72 @@ namespace eqdif {
       simulate(const time::Manager& manager) = 0;
   };
 
+  /// @brief - Defines what happens when the simulation falls behind
+  /// its schedule, typically because a step took longer than the
+  /// duration of a frame.
+  enum class CatchUp {
+    /// @brief - The late frames are dropped: the schedule restarts
+    /// from the current time and the simulation runs slower.
+    Skip,
+    /// @brief - The next frames are computed without waiting until
+    /// the schedule is caught up, so that the average rate is kept.
+    /// Frames later than the limit of the pacing policy are dropped.
+    Burst
+  };
+
+  /// @brief - Defines how the launcher maintains the desired rate.
+  /// Each frame has an absolute deadline derived from the previous
+  /// one so that the error on a frame does not accumulate.
+  struct PacingPolicy {
+    /// @brief - What to do when frames are late.
+    CatchUp catchUp;
+
+    /// @brief - The maximum number of late frames which are computed
+    /// in a burst, older ones are dropped.
+    unsigned maxLateFrames;
+
+    /// @brief - The duration before each deadline during which the
+    /// thread busy-waits instead of sleeping, to compensate for the
+    /// latency of the scheduler. A value of `0` always sleeps.
+    utils::Duration spin;
+  };
+
+  /**
+   * @brief - Generate the default pacing policy, which catches up a
+   *          few late frames and never busy-waits.
+   * @return - the pacing policy.
+   */
+  PacingPolicy
+  defaultPacingPolicy() noexcept;
+
+  /// @brief - Statistics about the rate at which the launcher runs the
+  /// simulation, since it was last started, resumed or since its rate
+  /// last changed.
+  struct RateStatistics {
+    /// @brief - The desired framerate.
+    float desired;
+
+    /// @brief - The framerate actually achieved.
+    float achieved;
+
+    /// @brief - The number of frames computed.
+    unsigned frames;
+
+    /// @brief - The number of frames which completed after their
+    /// deadline.
+    unsigned overruns;
+
+    /// @brief - The number of frames dropped by the catch up policy.
+    unsigned dropped;
+
+    /// @brief - The number of simulation steps computed in each frame.
+    unsigned stepsPerFrame;
+
+    /// @brief - The simulated time elapsed for each second of real
+    /// time at the desired framerate.
+    float timeRate;
+  };
+
   /// @brief - An operation which is to be performed when
   /// the simulation is locked.
   using LockedOperation = std::function<void(Process&)>;
@@ -93,6 +161,55 @@ namespace eqdif {
       void
       setDesiredFramerate(float fps);
 
+      /**
+       * @brief - Define how fast the simulated time passes compared
+       *          to the real time. The framerate is not changed: the
+       *          launcher rather computes several steps in each frame
+       *          so that the thread is woken up only once for all of
+       *          them. The number of steps per frame is derived from
+       *          the current framerate and duration of a step, and is
+       *          at least one. Nothing happens if the rate is negative
+       *          or zero.
+       * @param rate - the number of simulated seconds for each second
+       *               of real time.
+       */
+      void
+      setTimeRate(float rate);
+
+      /**
+       * @brief - Return the rate at which the simulated time passes
+       *          at the desired framerate. It may differ slightly from
+       *          the one requested as a whole number of steps is run
+       *          in each frame.
+       * @return - the number of simulated seconds for each second of
+       *           real time.
+       */
+      float
+      timeRate() const noexcept;
+
+      /**
+       * @brief - Return the number of simulation steps computed in
+       *          each frame.
+       * @return - the number of steps per frame.
+       */
+      unsigned
+      stepsPerFrame() const noexcept;
+
+      /**
+       * @brief - Define how the desired framerate is maintained.
+       * @param policy - the pacing policy.
+       */
+      void
+      setPacingPolicy(const PacingPolicy& policy);
+
+      /**
+       * @brief - Return statistics about the rate achieved by the
+       *          simulation compared to the desired one.
+       * @return - the rate statistics.
+       */
+      RateStatistics
+      rateStatistics() const noexcept;
+
       /**
        * @brief - Start the simulation. Nothing happens in case
        *          it is already running.
@@ -122,16 +239,18 @@ namespace eqdif {
       stop();
 
       /**
-       * @brief - Perform a single simulation step. Nothing happens
-       *          in case the simulation is running. Otherwise the
-       *          state is restored to its previous state.
+       * @brief - Perform a single simulation step, regardless of the
+       *          number of steps per frame. Nothing happens in case
+       *          the simulation is running. Otherwise the state is
+       *          restored to its previous state.
        */
       void
       step();
 
       /**
        * @brief - Execute the provided function after locking the
-       *          internal locker.
+       *          internal locker. The operation never runs while
+       *          steps are being computed.
        * @param - the operation to execute on the wrapped process.
        */
       void
@@ -156,24 +275,58 @@ namespace eqdif {
       asynchronousRunningLoop();
 
       /**
-       * @brief - Used to run a single simulation step. The input
-       *          boolean indicates whether the method should make
-       *          the current thread sleep in order to maintain
-       *          the desired FPS or not.
-       *          Note that we put the desired FPS in parameter to
-       *          have a state less function.
+       * @brief - Used to run a frame of the simulation, made of one
+       *          or several steps. The input boolean indicates whether
+       *          the method should make the current thread wait for
+       *          the deadline of the next frame in order to maintain
+       *          the desired FPS. Note that we put the desired FPS in
+       *          parameter to have a state less function.
        * @param sleep - `true` if the FPS should be considered or
        *                not.
        * @param desiredFPS - the desired framerate to maintain.
+       * @param steps - the number of steps to compute in the frame.
+       * @param pacing - how to maintain the framerate.
+       */
+      void
+      simulate(bool sleep,
+               float desiredFPS,
+               unsigned steps,
+               const PacingPolicy& pacing);
+
+      /**
+       * @brief - Compute the deadline of the next frame, applying the
+       *          catch up policy if the current one is late, and wait
+       *          until it is reached. The wait is interrupted if the
+       *          simulation stops running.
+       * @param desiredFPS - the desired framerate to maintain.
+       * @param pacing - how to maintain the framerate.
+       */
+      void
+      pace(float desiredFPS, const PacingPolicy& pacing);
+
+      /**
+       * @brief - Restart the schedule of the frames from the current
+       *          time and reset the rate statistics. Should be called
+       *          with the lock held.
        */
       void
-      simulate(bool sleep, float desiredFPS);
+      restartSchedule();
+
+      /**
+       * @brief - Reset the rate statistics. Should be called with the
+       *          lock held.
+       */
+      void
+      resetStatistics();
 
     private:
 
       /// @brief - Convenience define for a lock guard.
       using Guard = std::lock_guard<std::mutex>;
 
+      /// @brief - Convenience define for a unique lock.
+      using UniqueGuard = std::unique_lock<std::mutex>;
+
       /**
        * @brief - The process attached to this launcher.
        */
@@ -185,6 +338,21 @@ namespace eqdif {
        */
       mutable std::mutex m_simThreadLocker;
 
+      /**
+       * @brief - A mutex held while the process computes steps so
+       *          that operations on the process are not performed
+       *          concurrently. It is always locked after the locker
+       *          of the simulation thread when both are needed.
+       */
+      mutable std::mutex m_processLocker;
+
+      /**
+       * @brief - Used to wake up the simulation thread when the
+       *          state changes: it waits on it instead of polling
+       *          the state when there is nothing to simulate.
+       */
+      std::condition_variable m_stateNotifier;
+
       /**
        * @brief - The thread used to handle the simulation. This
        *          is initialized only when the simulation starts.
@@ -202,6 +370,12 @@ namespace eqdif {
        */
       float m_desiredFPS;
 
+      /**
+       * @brief - The number of simulation steps computed in each
+       *          frame.
+       */
+      unsigned m_stepsPerFrame;
+
       /**
        * @brief - The duration of a single simulation step.
        */
@@ -217,6 +391,40 @@ namespace eqdif {
        *          in the simulation.
        */
       time::Manager m_time;
+
+      /**
+       * @brief - How the desired framerate is maintained.
+       */
+      PacingPolicy m_pacing;
+
+      /**
+       * @brief - The deadline of the current frame. Only accessed by
+       *          the simulation thread.
+       */
+      utils::TimeStamp m_deadline;
+
+      /**
+       * @brief - The time from which the rate statistics are computed.
+       */
+      utils::TimeStamp m_statisticsStart;
+
+      /**
+       * @brief - The number of frames computed since the start of the
+       *          statistics.
+       */
+      unsigned m_frames;
+
+      /**
+       * @brief - The number of frames which completed after their
+       *          deadline since the start of the statistics.
+       */
+      unsigned m_overruns;
+
+      /**
+       * @brief - The number of frames dropped since the start of the
+       *          statistics.
+       */
+      unsigned m_dropped;
   };
 
 }
@@ -1,5 +1,6 @@
 
 # include "Manager.hh"
+# include <algorithm>
 
 namespace {
 
@@ -21,18 +22,6 @@ namespace {
     }
   }
 
-  float
-  convertDuration(float d,
-                  const eqdif::time::Unit& source,
-                  const eqdif::time::Unit& target) noexcept
-  {
-    // Convert the source into seconds.
-    float sec = d * fromUnitToSecond(source);
-
-    // Convert back into desired unit.
-    return sec / fromUnitToSecond(target);
-  }
-
 }
 
 namespace eqdif {
@@ -58,14 +47,25 @@ namespace eqdif {
       }
     }
 
+    float
+    convertDuration(float d, const Unit& source, const Unit& target) noexcept {
+      // Convert the source into seconds.
+      float sec = d * fromUnitToSecond(source);
+
+      // Convert back into desired unit.
+      return sec / fromUnitToSecond(target);
+    }
+
     Manager::Manager(float origin, const Unit& unit, unsigned frames):
       utils::CoreObject("time"),
 
       m_unit(unit),
       m_time(origin),
 
-      m_maxFrames(frames),
-      m_frames()
+      m_maxFrames(std::max(frames, 1u)),
+      m_frames(m_maxFrames, Frame(0.0f, unit)),
+      m_next(0u),
+      m_count(0u)
     {
       setService("eqdif");
     }
@@ -84,8 +84,8 @@ namespace eqdif {
     Manager::lastStepDuration(const Unit& unit) const noexcept {
       float last = 0.0f;
 
-      if (!m_frames.empty()) {
-        Frame lastFrame = m_frames.back();
+      if (m_count > 0u) {
+        Frame lastFrame = m_frames[(m_next + m_maxFrames - 1u) % m_maxFrames];
         last = convertDuration(lastFrame.first, lastFrame.second, unit);
       }
 
@@ -94,20 +94,22 @@ namespace eqdif {
 
     float
     Manager::elapsed(const Unit& unit) const noexcept {
-      return convertDuration(m_time, m_unit, unit);
+      // Convert in double precision to not lose the precision of
+      // the elapsed time.
+      return static_cast<float>(m_time * fromUnitToSecond(m_unit) / fromUnitToSecond(unit));
     }
 
     void
     Manager::handleTimeModification(float d, const Unit& unit) noexcept {
-      double sec = convertDuration(d, unit, m_unit);
+      double sec = static_cast<double>(d) * fromUnitToSecond(unit) / fromUnitToSecond(m_unit);
 
       m_time += sec;
 
-      // Add the step to the buffer
-      m_frames.push_back(std::make_pair(d, unit));
-      if (m_frames.size() > m_maxFrames) {
-        m_frames.pop_front();
-      }
+      // Add the step to the buffer, overwriting the oldest
+      // one if needed.
+      m_frames[m_next] = std::make_pair(d, unit);
+      m_next = (m_next + 1u) % m_maxFrames;
+      m_count = std::min(m_count + 1u, m_maxFrames);
     }
 
   }
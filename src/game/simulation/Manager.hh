@@ -1,7 +1,7 @@
 #ifndef    TIME_MANAGER_HH
 # define   TIME_MANAGER_HH
 
-# include <deque>
+# include <vector>
 # include <core_utils/CoreObject.hh>
 
 namespace eqdif {
@@ -25,6 +25,16 @@ namespace eqdif {
     std::string
     unitToString(const Unit& unit) noexcept;
 
+    /**
+     * @brief - Convert a duration from a time unit to another.
+     * @param d - the duration to convert.
+     * @param source - the unit in which the duration is expressed.
+     * @param target - the unit to convert the duration into.
+     * @return - the duration expressed in the target unit.
+     */
+    float
+    convertDuration(float d, const Unit& source, const Unit& target) noexcept;
+
     class Manager: public utils::CoreObject {
       public:
 
@@ -101,9 +111,11 @@ namespace eqdif {
 
         /**
          * @brief - The number of intervals of the defined time unit
-         *          elapsed since the origin of time.
+         *          elapsed since the origin of time. It is kept in
+         *          double precision so that small steps still move it
+         *          forward after a long time.
          */
-        float m_time;
+        double m_time;
 
         /**
          * @brief - How many frames are allowed to be saved in the
@@ -112,9 +124,22 @@ namespace eqdif {
         unsigned m_maxFrames;
 
         /**
-         * @brief - The last frames.
+         * @brief - The last frames. This is used as a circular
+         *          buffer of `m_maxFrames` elements so that no
+         *          memory is allocated when the time passes.
+         */
+        std::vector<Frame> m_frames;
+
+        /**
+         * @brief - The index of the next frame to write in the
+         *          circular buffer.
+         */
+        unsigned m_next;
+
+        /**
+         * @brief - The number of valid frames in the buffer.
          */
-        std::deque<Frame> m_frames;
+        unsigned m_count;
     };
 
   }
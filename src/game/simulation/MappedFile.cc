@@ -0,0 +1,74 @@
+
+# include "MappedFile.hh"
+# include <cerrno>
+# include <cstring>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+
+namespace eqdif {
+
+  MappedFile::MappedFile(const std::string& file):
+    utils::CoreObject("mapped-file"),
+
+    m_data(nullptr),
+    m_size(0u)
+  {
+    setService("eqdif");
+    addModule(file);
+
+    const int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+      error(
+        "Failed to map \"" + file + "\"",
+        "Failed to open file (" + std::string(std::strerror(errno)) + ")"
+      );
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+      ::close(fd);
+      error(
+        "Failed to map \"" + file + "\"",
+        "File is empty or can't be inspected"
+      );
+    }
+
+    m_size = static_cast<std::size_t>(info.st_size);
+
+    // The mapping is writable but private: changes are not written
+    // back to the file. The mapping stays valid once the file is
+    // closed.
+    void* data = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    const int err = errno;
+    ::close(fd);
+
+    if (data == MAP_FAILED) {
+      error(
+        "Failed to map \"" + file + "\"",
+        "Failed to map " + std::to_string(m_size) + " byte(s) (" +
+        std::string(std::strerror(err)) + ")"
+      );
+    }
+
+    m_data = static_cast<char*>(data);
+  }
+
+  MappedFile::~MappedFile() {
+    if (m_data != nullptr) {
+      ::munmap(m_data, m_size);
+    }
+  }
+
+  char*
+  MappedFile::data() const noexcept {
+    return m_data;
+  }
+
+  std::size_t
+  MappedFile::size() const noexcept {
+    return m_size;
+  }
+
+}
@@ -0,0 +1,59 @@
+#ifndef    MAPPED_FILE_HH
+# define   MAPPED_FILE_HH
+
+# include <string>
+# include <cstddef>
+# include <core_utils/CoreObject.hh>
+
+namespace eqdif {
+
+  /// @brief - A read-only file mapped in memory. The mapping is
+  /// private: the content can be modified in memory, in which case
+  /// the modified pages are copied and the file is left untouched.
+  /// This allows to use the data of the file directly as storage
+  /// without reading it first: pages are only loaded by the system
+  /// when they are accessed.
+  class MappedFile: public utils::CoreObject {
+    public:
+
+      /**
+       * @brief - Map the input file in memory. Raises an error if
+       *          the file can't be opened or mapped.
+       * @param file - the path to the file to map.
+       */
+      explicit
+      MappedFile(const std::string& file);
+
+      ~MappedFile();
+
+      MappedFile(const MappedFile&) = delete;
+
+      MappedFile&
+      operator=(const MappedFile&) = delete;
+
+      /**
+       * @brief - The content of the file.
+       * @return - a pointer to the first byte of the file.
+       */
+      char*
+      data() const noexcept;
+
+      /**
+       * @brief - The size of the file.
+       * @return - the size of the file in bytes.
+       */
+      std::size_t
+      size() const noexcept;
+
+    private:
+
+      /// @brief - The start of the mapping.
+      char* m_data;
+
+      /// @brief - The size of the mapping in bytes.
+      std::size_t m_size;
+  };
+
+}
+
+#endif    /* MAPPED_FILE_HH */
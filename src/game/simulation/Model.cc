@@ -1,60 +1,7 @@
 
 # include "Model.hh"
 
-# include <iostream>
-# include <cmath>
-
-namespace {
-
-  float
-  computeDerivative(const eqdif::Equation& eq, const std::vector<float>& values) {
-    // Compute derivative from the coefficients.
-    float derivative = 0.0f;
-
-    for (unsigned coeffId = 0u ; coeffId < eq.coeffs.size() ; ++coeffId) {
-      const eqdif::SingleCoefficient& sf = eq.coeffs[coeffId];
-
-      auto coeff = sf.value;
-
-      for (unsigned val = 0u ; val < sf.dependencies.size() ; ++val) {
-        const eqdif::VariableDependency& vd = sf.dependencies[val];
-        coeff *= std::pow(values[vd.id], vd.n);
-      }
-
-      derivative += coeff;
-    }
-
-    return derivative;
-  }
-
-  float
-  eulerMethod(const unsigned id, const std::vector<float>& values, const eqdif::Equation& eq, const float dt) {
-    // https://en.wikipedia.org/wiki/Euler_method
-    return values[id] + computeDerivative(eq, values) * dt;
-  }
-
-  float
-  rungeKutta4(const unsigned id, const std::vector<float>& values, const eqdif::Equation& eq, const float dt) {
-    // https://en.wikipedia.org/wiki/Runge%E2%80%93Kutta_methods
-    // https://www.geeksforgeeks.org/runge-kutta-4th-order-method-solve-differential-equation/
-    std::vector<float> tmpValues = values;
-    auto originalValue = values[id];
-
-    const float k1 = dt * computeDerivative(eq, tmpValues);
-
-    tmpValues[id] = originalValue + 0.5f * k1;
-    const float k2 = dt * computeDerivative(eq, tmpValues);
-
-    tmpValues[id] = originalValue + 0.5f * k2;
-    const float k3 = dt * computeDerivative(eq, tmpValues);
-
-    tmpValues[id] = originalValue + 0.5f * k3;
-    const float k4 = dt * computeDerivative(eq, tmpValues);
-
-    return values[id] + (1.0f / 6.0f) * (k1 + 2.0f * k2 + 2.0f * k3 + k4);
-  }
-
-}
+# include <type_traits>
 
 namespace eqdif {
 
@@ -65,61 +12,130 @@ namespace eqdif {
         return "euler";
       case SimulationMethod::RUNGE_KUTTA_4:
         return "runge-kutta-4";
+      case SimulationMethod::DORMAND_PRINCE_45:
+        return "dormand-prince-45";
+      case SimulationMethod::ROSENBROCK_2:
+        return "rosenbrock-2";
+      case SimulationMethod::BDF_2:
+        return "bdf-2";
+      case SimulationMethod::AUTOMATIC:
+        return "automatic";
+      case SimulationMethod::ADAMS_BASHFORTH_MOULTON:
+        return "adams-bashforth-moulton";
+      case SimulationMethod::VELOCITY_VERLET:
+        return "velocity-verlet";
       default:
         return "unknown";
     }
   }
 
-  Model::Model(const SimulationData& data):
+  Model::Model(const System& system,
+               const std::vector<Range>& ranges,
+               const SimulationMethod& method,
+               const Tolerance& tolerance):
     utils::CoreObject("model"),
 
-    m_data(data)
+    m_system(system),
+    m_ranges(ranges),
+    m_integrator(EulerIntegrator(0u))
   {
     setService("eqdif");
+    addModule(toString(method));
 
-    switch (m_data.method) {
+    const unsigned order = m_system.maxOrder();
+    if (order > 2u) {
+      error(
+        "Unable to create model",
+        "Equations of order " + std::to_string(order) + " are not supported"
+      );
+    }
+
+    const bool secondOrder = (order == 2u);
+    if (secondOrder && method != SimulationMethod::VELOCITY_VERLET && method != SimulationMethod::AUTOMATIC) {
+      error(
+        "Unable to create model",
+        "Second order equations are not supported by method " + toString(method)
+      );
+    }
+
+    switch (method) {
       case SimulationMethod::EULER:
-        m_evolve = eulerMethod;
+        m_integrator = EulerIntegrator(m_system.size());
         break;
       case SimulationMethod::RUNGE_KUTTA_4:
-        m_evolve = rungeKutta4;
+        m_integrator = RungeKutta4Integrator(m_system.size());
+        break;
+      case SimulationMethod::DORMAND_PRINCE_45:
+        m_integrator = DormandPrince45Integrator(m_system.size(), tolerance);
+        break;
+      case SimulationMethod::ROSENBROCK_2:
+        m_integrator = Rosenbrock2Integrator(m_system);
+        break;
+      case SimulationMethod::BDF_2:
+        m_integrator = Bdf2Integrator(m_system, tolerance);
+        break;
+      case SimulationMethod::AUTOMATIC:
+        if (secondOrder) {
+          info("Using " + toString(SimulationMethod::VELOCITY_VERLET) + " for second order equations");
+          m_integrator = VelocityVerletIntegrator(m_system);
+        }
+        else {
+          m_integrator = AutomaticIntegrator(m_system, tolerance);
+        }
+        break;
+      case SimulationMethod::ADAMS_BASHFORTH_MOULTON:
+        m_integrator = AdamsBashforthMoultonIntegrator(m_system.size());
+        break;
+      case SimulationMethod::VELOCITY_VERLET:
+        m_integrator = VelocityVerletIntegrator(m_system);
         break;
       default:
         error(
-          "Unableo to interpret ",
-          "Unknown simulation method " + toString(m_data.method)
+          "Unable to interpret simulation method",
+          "Unknown simulation method " + toString(method)
         );
         break;
     }
   }
 
-  std::vector<float>
-  Model::computeNextStep() const {
-    std::vector<float> out(m_data.vals.size(), 0.0f);
-
-    // Compute new values from the derivatives.
-    for (unsigned id = 0u ; id < m_data.vals.size() ; ++id) {
-      float newValue = m_evolve(
-        id,
-        m_data.vals,
-        m_data.system[id],
-        m_data.tDelta
-      );
-
-      const auto [lb, hb] = m_data.ranges[id];
-      newValue = std::clamp(newValue, lb, hb);
-
-      debug(
-        m_data.names[id] + " moved from "
-        + std::to_string(m_data.vals[id]) + " to "
-        + std::to_string(newValue) +
-        " (estimate derivative: " + std::to_string((newValue - m_data.vals[id]) / m_data.tDelta) + ")"
-      );
+  const CompiledSystem&
+  Model::system() const noexcept {
+    return m_system;
+  }
 
-      out[id] = newValue;
-    }
+  void
+  Model::resume(const float* previous) {
+    std::visit(
+      [previous](auto& integrator) {
+        using Type = std::decay_t<decltype(integrator)>;
+        if constexpr (std::is_same_v<Type, VelocityVerletIntegrator>) {
+          integrator.seed(previous);
+        }
+      },
+      m_integrator
+    );
+  }
 
-    return out;
+  void
+  Model::computeNextStep(const float* in, float* out, float tDelta) {
+    // Compute new values for the whole system.
+    std::visit(
+      [this, in, out, tDelta](auto& integrator) {
+        integrator.step(m_system, in, out, tDelta);
+      },
+      m_integrator
+    );
+
+    // The values are bounded through the integrator so that it can
+    // bound its internal state consistently. Note that we don't log
+    // anything here: this is called for each step and building the
+    // messages would allocate memory.
+    std::visit(
+      [this, out](auto& integrator) {
+        integrator.clamp(m_system, m_ranges, out);
+      },
+      m_integrator
+    );
   }
 
 }
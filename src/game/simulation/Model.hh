@@ -3,99 +3,93 @@
 
 # include <string>
 # include <vector>
+# include <variant>
 # include <core_utils/CoreObject.hh>
+# include "System.hh"
+# include "CompiledSystem.hh"
+# include "Integrators.hh"
 
 namespace eqdif {
 
-  /// @brief - The computation method to evolve the data.
-  enum class SimulationMethod {
-    EULER,
-    RUNGE_KUTTA_4
-  };
-
-  /**
-   * @brief - Convert the simulation mode to a readable string.
-   * @param - the mode to convert.
-   * @return - the name of the simulation method.
-   */
-  std::string
-  toString(const SimulationMethod& method) noexcept;
-
-  /// @brief - In general an equation can look something like this:
-  /// dx = Ax - Bxy
-  /// dy = Cxy - Dy
-  /// To represent that in a generic way, we need a way to represent
-  /// the dependencies for a single coefficient (this is the `Bxy`).
-  /// In order to allow higher order dependencies like:
-  /// dx = Ax^2
-  /// Each dependency should be a composite of an index and some
-  /// exponent.
-  struct VariableDependency {
-    unsigned id;
-    float n;
-  };
-
-  struct SingleCoefficient {
-    float value;
-    std::vector<VariableDependency> dependencies;
-  };
-
-  /// Then the list of coefficients for a single variable and its
-  /// order.
-  struct Equation {
-    int order;
-    std::vector<SingleCoefficient> coeffs;
-  };
-
-  /// And finally the list of coefficients for each variable.
-  using System = std::vector<Equation>;
-
-  /// A range represents the bounds for a variable.
-  using Range = std::pair<float, float>;
-
-  /// @brief - Convenience data storing all the needed info
-  /// on the simulation to evolve.
-  struct SimulationData {
-    /// @brief - The linear dependencies of variables on one
-    /// another.
-    const System& system;
-
-    /// @brief - The variable names.
-    const std::vector<std::string>& names;
-
-    /// @brief - The bounds for each variable.
-    const std::vector<Range>& ranges;
-
-    /// @brief - The current value of the variables.
-    const std::vector<float>& vals;
-
-    /// @brief - The simulation method to use to compute the
-    /// next step of the values.
-    SimulationMethod method;
-
-    /// @brief - The simulation time step: describes how far
-    /// in the future the values should be predicted.
-    float tDelta;
-  };
-
-  /// @brief - An interface for the evolution method.
-  using EvolutionMethod = std::function<float(const unsigned, const std::vector<float>&, const Equation&, const float)>;
-
+  /// @brief - The integrators which can be used to evolve the
+  /// model. The dispatch to the right one is static through the
+  /// use of `std::visit`.
+  using Integrator = std::variant<
+    EulerIntegrator,
+    RungeKutta4Integrator,
+    DormandPrince45Integrator,
+    Rosenbrock2Integrator,
+    Bdf2Integrator,
+    AutomaticIntegrator,
+    AdamsBashforthMoultonIntegrator,
+    VelocityVerletIntegrator
+  >;
+
+  /// @brief - The model is the persistent object used to compute
+  /// the successive steps of a simulation: it holds the compiled
+  /// system along with the integrator and its buffers. It should
+  /// be rebuilt whenever the system changes or the simulation is
+  /// reset, and reused for all the steps in between.
+  ///
+  /// Second order equations are only supported by the velocity
+  /// Verlet method, which the automatic method picks for systems
+  /// including some of them.
   class Model: public utils::CoreObject {
     public:
 
-      Model(const SimulationData& data);
-
-      std::vector<float>
-      computeNextStep() const;
+      /**
+       * @brief - Create a new model for the input system.
+       * @param system - the system of equations to simulate.
+       * @param ranges - the bounds of each variable.
+       * @param method - the integration method.
+       * @param tolerance - the error allowed on each step, only used
+       *                    by the adaptive and implicit methods.
+       */
+      Model(const System& system,
+            const std::vector<Range>& ranges,
+            const SimulationMethod& method,
+            const Tolerance& tolerance = defaultTolerance());
+
+      /**
+       * @brief - Return the compiled version of the system used by
+       *          this model.
+       * @return - the compiled system.
+       */
+      const CompiledSystem&
+      system() const noexcept;
+
+      /**
+       * @brief - Provide the values of the step preceding the next
+       *          one, for the integrators which need more than the
+       *          current values to resume a simulation (such as the
+       *          velocities of second order equations).
+       * @param previous - the values of the previous step.
+       */
+      void
+      resume(const float* previous);
+
+      /**
+       * @brief - Compute the next values of the variables from the
+       *          current ones.
+       * @param in - the current values of the variables.
+       * @param out - output array for the next values.
+       * @param tDelta - the simulation time step: describes how far
+       *                 in the future the values should be predicted.
+       */
+      void
+      computeNextStep(const float* in, float* out, float tDelta);
 
     private:
 
-      const SimulationData& m_data;
+      /// @brief - The compiled system used to evaluate derivatives.
+      CompiledSystem m_system;
+
+      /// @brief - The bounds for each variable.
+      std::vector<Range> m_ranges;
 
-      /// @brief - The evolution method: this is computed from the
-      /// simulation method attached to this model.
-      EvolutionMethod m_evolve;
+      /// @brief - The integrator used to evolve the variables: this
+      /// is computed from the simulation method of the model.
+      Integrator m_integrator;
   };
 
 }
@@ -0,0 +1,194 @@
+
+# include "Preview.hh"
+# include <algorithm>
+
+namespace {
+
+  /// @brief - The number of values stored for each variable in a
+  /// bucket of the preview: the minimum and maximum.
+  constexpr auto VALUES_PER_BUCKET = 2u;
+
+  /// @brief - The number of values stored for each variable in a
+  /// decimated bucket of a trajectory: the minimum, maximum and mean.
+  constexpr auto VALUES_PER_SUMMARY = 3u;
+
+}
+
+namespace eqdif {
+
+  Preview::Preview(unsigned variables):
+    m_variables(0u),
+    m_steps(0u),
+    m_span(1u),
+    m_values()
+  {
+    reset(variables);
+  }
+
+  void
+  Preview::reset(unsigned variables) {
+    m_variables = variables;
+    m_steps = 0u;
+    m_span = 1u;
+    m_values.assign(PREVIEW_BUCKETS * VALUES_PER_BUCKET * m_variables, 0.0f);
+  }
+
+  unsigned
+  Preview::variables() const noexcept {
+    return m_variables;
+  }
+
+  std::size_t
+  Preview::steps() const noexcept {
+    return m_steps;
+  }
+
+  std::size_t
+  Preview::span() const noexcept {
+    return m_span;
+  }
+
+  unsigned
+  Preview::buckets() const noexcept {
+    return (m_steps + m_span - 1u) / m_span;
+  }
+
+  bool
+  Preview::empty() const noexcept {
+    return m_steps == 0u;
+  }
+
+  float
+  Preview::min(unsigned bucket, unsigned variable) const noexcept {
+    return m_values[(bucket * m_variables + variable) * VALUES_PER_BUCKET];
+  }
+
+  float
+  Preview::max(unsigned bucket, unsigned variable) const noexcept {
+    return m_values[(bucket * m_variables + variable) * VALUES_PER_BUCKET + 1u];
+  }
+
+  const std::vector<float>&
+  Preview::values() const noexcept {
+    return m_values;
+  }
+
+  void
+  Preview::add(const float* step) {
+    add(step, step, 1u);
+  }
+
+  void
+  Preview::add(const float* min, const float* max, std::size_t count) {
+    if (count == 0u || m_variables == 0u) {
+      return;
+    }
+
+    const std::size_t last = m_steps + count - 1u;
+    while (last / m_span >= PREVIEW_BUCKETS) {
+      coarsen();
+    }
+
+    // The first bucket may already hold steps: the other ones are
+    // not used yet.
+    const std::size_t used = buckets();
+
+    for (std::size_t bucket = m_steps / m_span ; bucket <= last / m_span ; ++bucket) {
+      float* out = m_values.data() + bucket * m_variables * VALUES_PER_BUCKET;
+
+      for (unsigned var = 0u ; var < m_variables ; ++var) {
+        float* values = out + var * VALUES_PER_BUCKET;
+
+        if (bucket < used) {
+          values[0] = std::min(values[0], min[var]);
+          values[1] = std::max(values[1], max[var]);
+        }
+        else {
+          values[0] = min[var];
+          values[1] = max[var];
+        }
+      }
+    }
+
+    m_steps += count;
+  }
+
+  void
+  Preview::rebuild(const Trajectory& trajectory) {
+    reset(trajectory.variables());
+
+    std::vector<float> min(m_variables), max(m_variables);
+
+    // The decimated levels are ordered from the most recent to the
+    // oldest one.
+    const std::vector<DecimatedLevel>& levels = trajectory.levels();
+    for (auto level = levels.rbegin() ; level != levels.rend() ; ++level) {
+      const std::size_t size = VALUES_PER_SUMMARY * m_variables;
+
+      for (std::size_t id = 0u ; id + size <= level->buckets.size() ; id += size) {
+        for (unsigned var = 0u ; var < m_variables ; ++var) {
+          min[var] = level->buckets[id + VALUES_PER_SUMMARY * var];
+          max[var] = level->buckets[id + VALUES_PER_SUMMARY * var + 1u];
+        }
+
+        add(min.data(), max.data(), level->span);
+      }
+    }
+
+    std::size_t id = trajectory.first();
+    while (id < trajectory.size()) {
+      const std::size_t count = trajectory.contiguous(id);
+      const float* steps = trajectory.step(id);
+
+      for (std::size_t step = 0u ; step < count ; ++step) {
+        add(steps + step * m_variables);
+      }
+
+      id += count;
+    }
+  }
+
+  bool
+  Preview::restore(std::size_t steps, std::size_t span, std::vector<float> values) {
+    const bool consistent = (
+      span > 0u && (span & (span - 1u)) == 0u &&
+      (steps + span - 1u) / span <= PREVIEW_BUCKETS &&
+      values.size() == PREVIEW_BUCKETS * VALUES_PER_BUCKET * m_variables
+    );
+
+    if (!consistent) {
+      reset(m_variables);
+      return false;
+    }
+
+    m_steps = steps;
+    m_span = span;
+    m_values.swap(values);
+
+    return true;
+  }
+
+  void
+  Preview::coarsen() noexcept {
+    const std::size_t used = buckets();
+    const std::size_t size = m_variables * VALUES_PER_BUCKET;
+
+    for (std::size_t bucket = 0u ; 2u * bucket < used ; ++bucket) {
+      float* out = m_values.data() + bucket * size;
+      const float* lhs = m_values.data() + 2u * bucket * size;
+      const float* rhs = lhs + size;
+
+      // The last bucket may not have a neighbor.
+      const bool pair = (2u * bucket + 1u < used);
+
+      for (unsigned var = 0u ; var < m_variables ; ++var) {
+        const unsigned id = var * VALUES_PER_BUCKET;
+        out[id] = (pair ? std::min(lhs[id], rhs[id]) : lhs[id]);
+        out[id + 1u] = (pair ? std::max(lhs[id + 1u], rhs[id + 1u]) : lhs[id + 1u]);
+      }
+    }
+
+    m_span *= 2u;
+  }
+
+}
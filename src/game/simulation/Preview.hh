@@ -0,0 +1,166 @@
+#ifndef    PREVIEW_HH
+# define   PREVIEW_HH
+
+# include <vector>
+# include <cstddef>
+# include "Trajectory.hh"
+
+namespace eqdif {
+
+  /// @brief - The maximum number of buckets of a preview.
+  constexpr auto PREVIEW_BUCKETS = 64u;
+
+  /// @brief - A downsampled version of a whole trajectory, small
+  /// enough to be stored in the save files and displayed without
+  /// loading the steps. The steps are summarized in at most
+  /// `PREVIEW_BUCKETS` buckets holding the minimum and maximum of
+  /// each variable. All buckets cover the same number of steps: when
+  /// they are all used, they are merged by pairs and each one covers
+  /// twice as many steps. The preview can thus be updated with each
+  /// new step in constant time and memory.
+  class Preview {
+    public:
+
+      /**
+       * @brief - Create an empty preview.
+       * @param variables - the number of variables of each step.
+       */
+      explicit
+      Preview(unsigned variables = 0u);
+
+      /**
+       * @brief - Remove all the steps and define the number of
+       *          variables for the new ones.
+       * @param variables - the number of variables of each step.
+       */
+      void
+      reset(unsigned variables);
+
+      /**
+       * @brief - The number of variables in each step.
+       * @return - the number of variables.
+       */
+      unsigned
+      variables() const noexcept;
+
+      /**
+       * @brief - The number of steps summarized by the preview.
+       * @return - the number of steps.
+       */
+      std::size_t
+      steps() const noexcept;
+
+      /**
+       * @brief - The number of steps covered by each bucket.
+       * @return - the span of a bucket.
+       */
+      std::size_t
+      span() const noexcept;
+
+      /**
+       * @brief - The number of buckets in use.
+       * @return - the number of buckets.
+       */
+      unsigned
+      buckets() const noexcept;
+
+      /**
+       * @brief - Whether the preview does not summarize any step.
+       * @return - `true` if there are no steps.
+       */
+      bool
+      empty() const noexcept;
+
+      /**
+       * @brief - The minimum value reached by a variable in a bucket.
+       * @param bucket - the index of the bucket.
+       * @param variable - the index of the variable.
+       * @return - the minimum value.
+       */
+      float
+      min(unsigned bucket, unsigned variable) const noexcept;
+
+      /**
+       * @brief - The maximum value reached by a variable in a bucket.
+       * @param bucket - the index of the bucket.
+       * @param variable - the index of the variable.
+       * @return - the maximum value.
+       */
+      float
+      max(unsigned bucket, unsigned variable) const noexcept;
+
+      /**
+       * @brief - The values of all the buckets, laid out as `[min, max]`
+       *          for each variable in order. Room is always kept for
+       *          `PREVIEW_BUCKETS` buckets.
+       * @return - the values of the buckets.
+       */
+      const std::vector<float>&
+      values() const noexcept;
+
+      /**
+       * @brief - Add a new step at the end of the preview.
+       * @param step - the `variables()` values of the step.
+       */
+      void
+      add(const float* step);
+
+      /**
+       * @brief - Add a range of consecutive steps described by their
+       *          extrema at the end of the preview. All the buckets
+       *          overlapping the range are updated.
+       * @param min - the `variables()` minimum values of the steps.
+       * @param max - the `variables()` maximum values of the steps.
+       * @param count - the number of steps in the range.
+       */
+      void
+      add(const float* min, const float* max, std::size_t count);
+
+      /**
+       * @brief - Replace the content of the preview with a summary of
+       *          the input trajectory, including its decimated steps.
+       * @param trajectory - the trajectory to summarize.
+       */
+      void
+      rebuild(const Trajectory& trajectory);
+
+      /**
+       * @brief - Restore the content of the preview as it was saved.
+       * @param steps - the number of steps summarized.
+       * @param span - the number of steps covered by each bucket.
+       * @param values - the values of the buckets, as returned by
+       *                 `values()`.
+       * @return - `false` if the values are not consistent with the
+       *           number of steps, in which case the preview is left
+       *           empty.
+       */
+      bool
+      restore(std::size_t steps, std::size_t span, std::vector<float> values);
+
+    private:
+
+      /**
+       * @brief - Merge the buckets by pairs, doubling their span.
+       */
+      void
+      coarsen() noexcept;
+
+    private:
+
+      /// @brief - The number of variables in each step.
+      unsigned m_variables;
+
+      /// @brief - The number of steps summarized.
+      std::size_t m_steps;
+
+      /// @brief - The number of steps covered by each bucket, always
+      /// a power of two.
+      std::size_t m_span;
+
+      /// @brief - The `[min, max]` of each variable for each bucket.
+      std::vector<float> m_values;
+  };
+
+}
+
+#endif    /* PREVIEW_HH */
@@ -0,0 +1,503 @@
+
+# include "SaveFile.hh"
+# include <limits>
+# include <cstddef>
+# include <fstream>
+# include <algorithm>
+
+namespace eqdif {
+
+  namespace {
+
+    /// @brief - The number of values stored for each variable in a
+    /// bucket of decimated data.
+    constexpr auto VALUES_PER_SUMMARY = 3u;
+
+    /// @brief - The number of values stored for each variable in a
+    /// bucket of the preview.
+    constexpr auto VALUES_PER_PREVIEW_BUCKET = 2u;
+
+    /// @brief - The size of the header in the version 2 of the format,
+    /// which ends before the position of the preview section.
+    constexpr auto V2_HEADER_SIZE = offsetof(SaveFileHeader, previewOffset);
+
+    /**
+     * @brief - Read the header of a save file from a stream.
+     * @param in - the stream, positioned at the start of the file.
+     * @param header - output header.
+     * @return - `false` if the stream does not start with a header of
+     *           a supported version.
+     */
+    bool
+    readHeader(std::istream& in, SaveFileHeader& header) {
+      char data[sizeof(SaveFileHeader)] = {};
+      in.read(data, sizeof(data));
+
+      const std::size_t size = static_cast<std::size_t>(in.gcount());
+      in.clear();
+
+      return eqdif::readHeader(data, size, header);
+    }
+
+    /**
+     * @brief - Whether a section of a save file lies within the
+     *          stream, so that it can be read safely.
+     * @param in - the stream to the save file.
+     * @param offset - the position of the section in the file.
+     * @param size - the size of the section in bytes.
+     * @return - `true` if the section is within the stream.
+     */
+    bool
+    isInStream(std::istream& in, std::uint64_t offset, std::uint64_t size) {
+      in.seekg(0, std::ios::end);
+      const std::streamoff end = in.tellg();
+      if (end < 0) {
+        return false;
+      }
+
+      const std::uint64_t length = static_cast<std::uint64_t>(end);
+      return offset <= length && size <= length - offset;
+    }
+
+    /**
+     * @brief - The size of the preview section of a save file.
+     * @param variables - the number of variables of the simulation.
+     * @return - the size of the section in bytes.
+     */
+    std::uint64_t
+    previewSectionSize(std::uint64_t variables) noexcept {
+      return 2u * sizeof(std::uint64_t) + variables * PREVIEW_BUCKETS * VALUES_PER_PREVIEW_BUCKET * sizeof(float);
+    }
+
+    bool
+    readBinarySummary(std::istream& in, SaveFileSummary& summary) {
+      SaveFileHeader header;
+      if (!readHeader(in, header)) {
+        return false;
+      }
+
+      // Only the model section is read, as long as it is within
+      // the file.
+      if (!isInStream(in, header.modelOffset, header.modelSize)) {
+        return false;
+      }
+
+      std::vector<char> model(header.modelSize);
+      in.seekg(header.modelOffset);
+      in.read(model.data(), model.size());
+
+      if (!in.good()) {
+        return false;
+      }
+
+      std::vector<float> initialValues;
+      std::vector<Range> ranges;
+      System system;
+
+      SaveFileReader reader(model.data(), model.size());
+      if (!readModel(reader, header.variables, summary.variables, initialValues, ranges, system)) {
+        return false;
+      }
+
+      summary.legacy = false;
+      summary.method = static_cast<SimulationMethod>(header.method);
+      summary.steps = header.first + header.steps;
+
+      return true;
+    }
+
+    bool
+    readLegacySummary(std::istream& in, SaveFileSummary& summary) {
+      unsigned count = 0u;
+      if (!(in >> count)) {
+        return false;
+      }
+
+      summary.variables.clear();
+
+      // Skip the properties and equation of each variable.
+      for (unsigned id = 0u ; id < count ; ++id) {
+        std::string name;
+        float value = 0.0f;
+
+        in >> name >> value >> value >> value;
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+        unsigned order = 0u, coefficients = 0u;
+        in.read(reinterpret_cast<char*>(&order), sizeof(unsigned));
+        in.read(reinterpret_cast<char*>(&coefficients), sizeof(unsigned));
+
+        for (unsigned coeff = 0u ; coeff < coefficients && in.good() ; ++coeff) {
+          unsigned dependencies = 0u;
+          in.ignore(sizeof(float));
+          in.read(reinterpret_cast<char*>(&dependencies), sizeof(unsigned));
+          in.ignore(static_cast<std::streamsize>(dependencies) * (sizeof(unsigned) + sizeof(float)));
+        }
+
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+        if (!in.good()) {
+          return false;
+        }
+
+        summary.variables.push_back(name);
+      }
+
+      unsigned steps = 0u;
+      if (!(in >> steps)) {
+        return false;
+      }
+
+      in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+      // The index of the first step at full resolution is right
+      // after the steps, when each of them holds one line.
+      std::size_t first = 0u;
+      in.seekg(static_cast<std::streamoff>(steps) * (count * sizeof(float) + 1u), std::ios::cur);
+      if (!(in >> first)) {
+        first = 0u;
+      }
+
+      summary.legacy = true;
+      summary.method = SimulationMethod::EULER;
+      summary.steps = first + steps;
+
+      return true;
+    }
+
+  }
+
+  bool
+  isSaveFile(const char* data, std::size_t size) noexcept {
+    return size >= V2_HEADER_SIZE &&
+           std::memcmp(data, SAVE_FILE_MAGIC, sizeof(SAVE_FILE_MAGIC)) == 0;
+  }
+
+  bool
+  readHeader(const char* data, std::size_t size, SaveFileHeader& header) noexcept {
+    if (!isSaveFile(data, size)) {
+      return false;
+    }
+
+    header = SaveFileHeader{};
+    std::memcpy(&header, data, V2_HEADER_SIZE);
+
+    if (header.version < SAVE_FILE_OLDEST_VERSION || header.version > SAVE_FILE_VERSION) {
+      return false;
+    }
+
+    if (header.version == SAVE_FILE_OLDEST_VERSION) {
+      return true;
+    }
+
+    if (size < sizeof(SaveFileHeader)) {
+      return false;
+    }
+
+    std::memcpy(&header, data, sizeof(SaveFileHeader));
+
+    return true;
+  }
+
+  bool
+  readSummary(const std::string& file, SaveFileSummary& summary) {
+    std::ifstream in(file.c_str(), std::ios::binary);
+
+    char magic[sizeof(SAVE_FILE_MAGIC)] = {};
+    in.read(magic, sizeof(magic));
+
+    if (!in.good()) {
+      return false;
+    }
+
+    const bool binary = std::equal(magic, magic + sizeof(magic), SAVE_FILE_MAGIC);
+    in.seekg(0);
+
+    return (binary ? readBinarySummary(in, summary) : readLegacySummary(in, summary));
+  }
+
+  bool
+  readPreview(const std::string& file, Preview& preview) {
+    std::ifstream in(file.c_str(), std::ios::binary);
+
+    SaveFileHeader header;
+    if (!readHeader(in, header) || header.previewSize == 0u) {
+      return false;
+    }
+
+    // The preview section has a fixed size for a given number of
+    // variables: this also prevents corrupted files to trigger
+    // large allocations.
+    if (header.previewSize != previewSectionSize(header.variables) ||
+        !isInStream(in, header.previewOffset, header.previewSize))
+    {
+      return false;
+    }
+
+    std::vector<char> data(header.previewSize);
+    in.seekg(header.previewOffset);
+    in.read(data.data(), data.size());
+
+    if (!in.good()) {
+      return false;
+    }
+
+    SaveFileReader reader(data.data(), data.size());
+    return readPreview(reader, header.variables, preview);
+  }
+
+  std::size_t
+  alignStepsOffset(std::size_t offset) noexcept {
+    return (offset + SAVE_FILE_STEPS_ALIGNMENT - 1u) / SAVE_FILE_STEPS_ALIGNMENT * SAVE_FILE_STEPS_ALIGNMENT;
+  }
+
+  SaveFileReader::SaveFileReader(const char* data, std::size_t size) noexcept:
+    m_data(data),
+    m_size(size),
+    m_offset(0u)
+  {}
+
+  bool
+  SaveFileReader::read(std::string& str) {
+    std::uint32_t length = 0u;
+    if (!read(length) || remaining() < length) {
+      return false;
+    }
+
+    str.assign(m_data + m_offset, length);
+    m_offset += length;
+
+    return true;
+  }
+
+  bool
+  SaveFileReader::read(float* values, std::size_t count) noexcept {
+    if (remaining() / sizeof(float) < count) {
+      return false;
+    }
+
+    std::memcpy(values, m_data + m_offset, count * sizeof(float));
+    m_offset += count * sizeof(float);
+
+    return true;
+  }
+
+  bool
+  SaveFileReader::view(std::size_t size, const char*& data) noexcept {
+    if (remaining() < size) {
+      return false;
+    }
+
+    data = m_data + m_offset;
+    m_offset += size;
+
+    return true;
+  }
+
+  std::size_t
+  SaveFileReader::remaining() const noexcept {
+    return m_size - m_offset;
+  }
+
+  SaveFileWriter::SaveFileWriter(std::ostream& out) noexcept:
+    m_out(out)
+  {}
+
+  void
+  SaveFileWriter::write(const std::string& str) {
+    write(static_cast<std::uint32_t>(str.size()));
+    m_out.write(str.data(), str.size());
+  }
+
+  void
+  SaveFileWriter::write(const float* values, std::size_t count) {
+    m_out.write(reinterpret_cast<const char*>(values), count * sizeof(float));
+  }
+
+  void
+  SaveFileWriter::write(const std::uint8_t* bytes, std::size_t count) {
+    m_out.write(reinterpret_cast<const char*>(bytes), count);
+  }
+
+  void
+  SaveFileWriter::alignForSteps() {
+    const std::size_t current = offset();
+    const std::size_t padding = alignStepsOffset(current) - current;
+
+    for (std::size_t id = 0u ; id < padding ; ++id) {
+      m_out.put('\0');
+    }
+  }
+
+  std::size_t
+  SaveFileWriter::offset() const {
+    return static_cast<std::size_t>(m_out.tellp());
+  }
+
+  void
+  writeModel(SaveFileWriter& writer,
+             const std::vector<std::string>& names,
+             const std::vector<float>& initialValues,
+             const std::vector<Range>& ranges,
+             const System& system)
+  {
+    for (unsigned id = 0u ; id < names.size() ; ++id) {
+      writer.write(names[id]);
+      writer.write(initialValues[id]);
+      writer.write(ranges[id].first);
+      writer.write(ranges[id].second);
+
+      const Equation& eq = system[id];
+      writer.write(static_cast<std::int32_t>(eq.order));
+      writer.write(static_cast<std::uint32_t>(eq.coeffs.size()));
+
+      for (const SingleCoefficient& sf : eq.coeffs) {
+        writer.write(sf.value);
+        writer.write(static_cast<std::uint32_t>(sf.dependencies.size()));
+
+        for (const VariableDependency& vd : sf.dependencies) {
+          writer.write(static_cast<std::uint32_t>(vd.id));
+          writer.write(vd.n);
+        }
+      }
+    }
+  }
+
+  bool
+  readModel(SaveFileReader& reader,
+            unsigned variables,
+            std::vector<std::string>& names,
+            std::vector<float>& initialValues,
+            std::vector<Range>& ranges,
+            System& system)
+  {
+    names.clear();
+    initialValues.clear();
+    ranges.clear();
+    system.clear();
+
+    for (unsigned id = 0u ; id < variables ; ++id) {
+      std::string name;
+      float initialValue = 0.0f;
+      Range ra;
+
+      if (!reader.read(name) || !reader.read(initialValue) ||
+          !reader.read(ra.first) || !reader.read(ra.second))
+      {
+        return false;
+      }
+
+      Equation eq;
+      std::int32_t order = 0;
+      std::uint32_t coefficientsCount = 0u;
+
+      if (!reader.read(order) || !reader.read(coefficientsCount)) {
+        return false;
+      }
+
+      eq.order = order;
+
+      for (unsigned coeff = 0u ; coeff < coefficientsCount ; ++coeff) {
+        SingleCoefficient sf;
+        std::uint32_t depCount = 0u;
+
+        if (!reader.read(sf.value) || !reader.read(depCount)) {
+          return false;
+        }
+
+        for (unsigned dep = 0u ; dep < depCount ; ++dep) {
+          std::uint32_t depId = 0u;
+          VariableDependency vd{0u, 1.0f};
+
+          if (!reader.read(depId) || !reader.read(vd.n)) {
+            return false;
+          }
+
+          vd.id = depId;
+          sf.dependencies.push_back(vd);
+        }
+
+        eq.coeffs.push_back(sf);
+      }
+
+      names.push_back(name);
+      initialValues.push_back(initialValue);
+      ranges.push_back(ra);
+      system.push_back(eq);
+    }
+
+    return true;
+  }
+
+  void
+  writePreview(SaveFileWriter& writer, const Preview& preview) {
+    writer.write(static_cast<std::uint64_t>(preview.steps()));
+    writer.write(static_cast<std::uint64_t>(preview.span()));
+    writer.write(preview.values().data(), preview.values().size());
+  }
+
+  bool
+  readPreview(SaveFileReader& reader, unsigned variables, Preview& preview) {
+    preview.reset(variables);
+
+    std::uint64_t steps = 0u, span = 0u;
+    std::vector<float> values(PREVIEW_BUCKETS * VALUES_PER_PREVIEW_BUCKET * variables);
+
+    if (!reader.read(steps) || !reader.read(span) || !reader.read(values.data(), values.size())) {
+      return false;
+    }
+
+    return preview.restore(steps, span, std::move(values));
+  }
+
+  void
+  writeLevels(SaveFileWriter& writer, const std::vector<DecimatedLevel>& levels) {
+    writer.write(static_cast<std::uint32_t>(levels.size()));
+
+    for (const DecimatedLevel& level : levels) {
+      writer.write(static_cast<std::uint64_t>(level.span));
+      writer.write(static_cast<std::uint64_t>(level.first));
+      writer.write(static_cast<std::uint64_t>(level.buckets.size()));
+      writer.write(level.buckets.data(), level.buckets.size());
+    }
+  }
+
+  bool
+  readLevels(SaveFileReader& reader,
+             unsigned variables,
+             std::vector<DecimatedLevel>& levels)
+  {
+    levels.clear();
+
+    std::uint32_t count = 0u;
+    if (!reader.read(count)) {
+      return false;
+    }
+
+    for (unsigned id = 0u ; id < count ; ++id) {
+      std::uint64_t span = 0u, first = 0u, values = 0u;
+
+      if (!reader.read(span) || !reader.read(first) || !reader.read(values)) {
+        return false;
+      }
+
+      // Make sure that the values are available before allocating
+      // memory for them, and that they form complete buckets.
+      if (reader.remaining() / sizeof(float) < values ||
+          values % (VALUES_PER_SUMMARY * std::max(variables, 1u)) != 0u)
+      {
+        return false;
+      }
+
+      DecimatedLevel level{span, first, std::vector<float>(values)};
+      if (!reader.read(level.buckets.data(), values)) {
+        return false;
+      }
+
+      levels.push_back(std::move(level));
+    }
+
+    return true;
+  }
+
+}
@@ -0,0 +1,360 @@
+#ifndef    SAVE_FILE_HH
+# define   SAVE_FILE_HH
+
+# include <string>
+# include <vector>
+# include <cstdint>
+# include <cstddef>
+# include <ostream>
+# include "System.hh"
+# include "Trajectory.hh"
+# include "Preview.hh"
+
+namespace eqdif {
+
+  /// @brief - The binary format of the saved simulations. The file
+  /// starts with a fixed size header which describes where to find
+  /// each section:
+  ///  - the preview section holds a downsampled version of the whole
+  ///    trajectory, see `Preview`. Its size only depends on the number
+  ///    of variables so that it can be updated in place.
+  ///  - the model section holds the variables (name, initial value
+  ///    and range) and their equations.
+  ///  - the decimated section holds the levels of decimated steps.
+  ///  - the steps section holds the steps at full resolution as a
+  ///    contiguous block of `steps x variables` floats. It is the
+  ///    last section of the file and starts at an offset aligned on
+  ///    `SAVE_FILE_STEPS_ALIGNMENT` so that it can be mapped in
+  ///    memory and used as is, and new steps can be appended to it.
+  ///    When the steps are compressed, the section is rather made of
+  ///    blocks: each one starts with its number of steps followed by
+  ///    the size and the encoded values of each variable.
+  /// All values are stored in the native byte order.
+
+  /// @brief - The magic bytes at the start of each save file.
+  constexpr char SAVE_FILE_MAGIC[8] = {'E', 'Q', 'D', 'I', 'F', 'M', 'O', 'D'};
+
+  /// @brief - The version of the binary format.
+  constexpr std::uint32_t SAVE_FILE_VERSION = 3u;
+
+  /// @brief - The oldest version of the binary format which can still
+  /// be read: it does not have a preview section.
+  constexpr std::uint32_t SAVE_FILE_OLDEST_VERSION = 2u;
+
+  /// @brief - The alignment of the steps section.
+  constexpr std::size_t SAVE_FILE_STEPS_ALIGNMENT = 4096u;
+
+  struct SaveFileHeader {
+    /// @brief - Should be `SAVE_FILE_MAGIC`.
+    char magic[8];
+
+    /// @brief - The version of the format.
+    std::uint32_t version;
+
+    /// @brief - The simulation method used to produce the steps.
+    std::uint32_t method;
+
+    /// @brief - The number of variables of the simulation.
+    std::uint32_t variables;
+
+    /// @brief - The encoding of the steps section.
+    std::uint32_t encoding;
+
+    /// @brief - The position and size in bytes of the model section.
+    std::uint64_t modelOffset;
+    std::uint64_t modelSize;
+
+    /// @brief - The position and size in bytes of the decimated
+    /// section.
+    std::uint64_t decimatedOffset;
+    std::uint64_t decimatedSize;
+
+    /// @brief - The index of the first step at full resolution.
+    std::uint64_t first;
+
+    /// @brief - The position of the steps section and the number of
+    /// steps it contains.
+    std::uint64_t stepsOffset;
+    std::uint64_t steps;
+
+    /// @brief - The position and size in bytes of the preview section.
+    /// Not available before version 3.
+    std::uint64_t previewOffset;
+    std::uint64_t previewSize;
+  };
+
+  /**
+   * @brief - Whether the input data starts with a save file header.
+   * @param data - the data to check.
+   * @param size - the size of the data in bytes.
+   * @return - `true` if the data starts with the magic bytes.
+   */
+  bool
+  isSaveFile(const char* data, std::size_t size) noexcept;
+
+  /**
+   * @brief - Read the header of a save file. Headers of older versions
+   *          of the format are converted: the sections which did not
+   *          exist yet are empty.
+   * @param data - the data to read the header from.
+   * @param size - the size of the data in bytes.
+   * @param header - output header.
+   * @return - `false` if the data does not start with a header of a
+   *           supported version.
+   */
+  bool
+  readHeader(const char* data, std::size_t size, SaveFileHeader& header) noexcept;
+
+  /// @brief - The description of a saved simulation, which can be
+  /// read without loading its steps.
+  struct SaveFileSummary {
+    /// @brief - Whether the file uses the legacy format. In this case
+    /// the simulation method is not known.
+    bool legacy;
+
+    /// @brief - The simulation method used to produce the steps.
+    SimulationMethod method;
+
+    /// @brief - The names of the variables.
+    std::vector<std::string> variables;
+
+    /// @brief - The number of steps of the simulation, including the
+    /// ones which were decimated.
+    std::uint64_t steps;
+  };
+
+  /**
+   * @brief - Read the description of a saved simulation from the
+   *          header and model section of the file. Both the binary
+   *          and the legacy formats are supported.
+   * @param file - the path to the save file.
+   * @param summary - output description of the simulation.
+   * @return - `false` if the file can't be read or is not a save file.
+   */
+  bool
+  readSummary(const std::string& file, SaveFileSummary& summary);
+
+  /**
+   * @brief - Read the preview of a saved simulation from the header
+   *          and preview section of the file, without reading the
+   *          steps.
+   * @param file - the path to the save file.
+   * @param preview - output preview of the simulation.
+   * @return - `false` if the file can't be read or does not hold a
+   *           preview, which is the case of the legacy format.
+   */
+  bool
+  readPreview(const std::string& file, Preview& preview);
+
+  /**
+   * @brief - Round up the input offset to the alignment of the steps
+   *          section.
+   * @param offset - the offset to align.
+   * @return - the aligned offset.
+   */
+  std::size_t
+  alignStepsOffset(std::size_t offset) noexcept;
+
+  /// @brief - Convenience class to read values from the sections of
+  /// a save file. All read operations check that enough data remains
+  /// and return `false` otherwise.
+  class SaveFileReader {
+    public:
+
+      /**
+       * @brief - Create a reader for the input data.
+       * @param data - the data to read.
+       * @param size - the size of the data in bytes.
+       */
+      SaveFileReader(const char* data, std::size_t size) noexcept;
+
+      /**
+       * @brief - Read a single value.
+       * @param value - output value.
+       * @return - `true` if the value could be read.
+       */
+      template <typename Value>
+      bool
+      read(Value& value) noexcept;
+
+      /**
+       * @brief - Read a string stored as its length and characters.
+       * @param str - output string.
+       * @return - `true` if the string could be read.
+       */
+      bool
+      read(std::string& str);
+
+      /**
+       * @brief - Read an array of floats.
+       * @param values - output array with room for `count` values.
+       * @param count - the number of values to read.
+       * @return - `true` if the values could be read.
+       */
+      bool
+      read(float* values, std::size_t count) noexcept;
+
+      /**
+       * @brief - Access the next bytes without copying them.
+       * @param size - the number of bytes to access.
+       * @param data - output pointer to the first byte.
+       * @return - `true` if enough bytes are available.
+       */
+      bool
+      view(std::size_t size, const char*& data) noexcept;
+
+      /**
+       * @brief - The number of bytes not read yet.
+       * @return - the number of bytes left.
+       */
+      std::size_t
+      remaining() const noexcept;
+
+    private:
+
+      const char* m_data;
+      std::size_t m_size;
+      std::size_t m_offset;
+  };
+
+  /// @brief - Convenience class to write values in a save file in
+  /// the format expected by the `SaveFileReader`.
+  class SaveFileWriter {
+    public:
+
+      /**
+       * @brief - Create a writer for the input stream, which should
+       *          be opened in binary mode.
+       * @param out - the stream to write to.
+       */
+      explicit
+      SaveFileWriter(std::ostream& out) noexcept;
+
+      /**
+       * @brief - Write a single value.
+       * @param value - the value to write.
+       */
+      template <typename Value>
+      void
+      write(const Value& value);
+
+      /**
+       * @brief - Write a string as its length and characters.
+       * @param str - the string to write.
+       */
+      void
+      write(const std::string& str);
+
+      /**
+       * @brief - Write an array of floats.
+       * @param values - the values to write.
+       * @param count - the number of values to write.
+       */
+      void
+      write(const float* values, std::size_t count);
+
+      /**
+       * @brief - Write an array of bytes.
+       * @param bytes - the bytes to write.
+       * @param count - the number of bytes to write.
+       */
+      void
+      write(const std::uint8_t* bytes, std::size_t count);
+
+      /**
+       * @brief - Write zeros until the position in the stream is a
+       *          multiple of the alignment of the steps section.
+       */
+      void
+      alignForSteps();
+
+      /**
+       * @brief - The current position in the stream.
+       * @return - the position in bytes.
+       */
+      std::size_t
+      offset() const;
+
+    private:
+
+      std::ostream& m_out;
+  };
+
+  /**
+   * @brief - Write the model section of a save file.
+   * @param writer - the writer to use.
+   * @param names - the names of the variables.
+   * @param initialValues - the initial values of the variables.
+   * @param ranges - the ranges of the variables.
+   * @param system - the equations of the variables.
+   */
+  void
+  writeModel(SaveFileWriter& writer,
+             const std::vector<std::string>& names,
+             const std::vector<float>& initialValues,
+             const std::vector<Range>& ranges,
+             const System& system);
+
+  /**
+   * @brief - Read the model section of a save file. The outputs are
+   *          cleared first.
+   * @param reader - the reader to use.
+   * @param variables - the number of variables to read.
+   * @param names - output names of the variables.
+   * @param initialValues - output initial values of the variables.
+   * @param ranges - output ranges of the variables.
+   * @param system - output equations of the variables.
+   * @return - `false` if the section is truncated.
+   */
+  bool
+  readModel(SaveFileReader& reader,
+            unsigned variables,
+            std::vector<std::string>& names,
+            std::vector<float>& initialValues,
+            std::vector<Range>& ranges,
+            System& system);
+
+  /**
+   * @brief - Write the preview section of a save file. Its size only
+   *          depends on the number of variables of the preview.
+   * @param writer - the writer to use.
+   * @param preview - the preview to write.
+   */
+  void
+  writePreview(SaveFileWriter& writer, const Preview& preview);
+
+  /**
+   * @brief - Read the preview section of a save file.
+   * @param reader - the reader to use.
+   * @param variables - the number of variables of the simulation.
+   * @param preview - output preview.
+   * @return - `false` if the section is truncated or invalid.
+   */
+  bool
+  readPreview(SaveFileReader& reader, unsigned variables, Preview& preview);
+
+  /**
+   * @brief - Write the decimated section of a save file.
+   * @param writer - the writer to use.
+   * @param levels - the levels of decimated data.
+   */
+  void
+  writeLevels(SaveFileWriter& writer, const std::vector<DecimatedLevel>& levels);
+
+  /**
+   * @brief - Read the decimated section of a save file.
+   * @param reader - the reader to use.
+   * @param variables - the number of variables of the simulation.
+   * @param levels - output levels of decimated data.
+   * @return - `false` if the section is truncated.
+   */
+  bool
+  readLevels(SaveFileReader& reader,
+             unsigned variables,
+             std::vector<DecimatedLevel>& levels);
+
+}
+
+# include "SaveFile.hxx"
+
+#endif    /* SAVE_FILE_HH */
@@ -0,0 +1,37 @@
+#ifndef    SAVE_FILE_HXX
+# define   SAVE_FILE_HXX
+
+# include "SaveFile.hh"
+# include <cstring>
+# include <type_traits>
+
+namespace eqdif {
+
+  template <typename Value>
+  inline
+  bool
+  SaveFileReader::read(Value& value) noexcept {
+    static_assert(std::is_trivially_copyable<Value>::value, "Only plain values can be read");
+
+    if (m_size - m_offset < sizeof(Value)) {
+      return false;
+    }
+
+    std::memcpy(&value, m_data + m_offset, sizeof(Value));
+    m_offset += sizeof(Value);
+
+    return true;
+  }
+
+  template <typename Value>
+  inline
+  void
+  SaveFileWriter::write(const Value& value) {
+    static_assert(std::is_trivially_copyable<Value>::value, "Only plain values can be written");
+
+    m_out.write(reinterpret_cast<const char*>(&value), sizeof(Value));
+  }
+
+}
+
+#endif    /* SAVE_FILE_HXX */
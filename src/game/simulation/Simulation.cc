@@ -1,19 +1,81 @@
 
 # include "Simulation.hh"
+# include <atomic>
+# include <cstdio>
+# include <thread>
+# include <cstring>
 # include <fstream>
+# include <core_utils/TimeUtils.hh>
+# include "SaveFile.hh"
 
 namespace eqdif {
 
   namespace {
 
     unsigned
-    eatEndOfLine(std::ifstream& in) {
+    eatEndOfLine(std::istream& in) {
       std::string dummy;
       std::getline(in, dummy);
 
       return dummy.size();
     }
 
+    /// @brief - The number of steps for which memory is reserved
+    /// in the history when a simulation is created or reset.
+    constexpr auto HISTORY_RESERVED_STEPS = 16384u;
+
+    /// @brief - The number of the most recent chunks of the history
+    /// which are never compressed.
+    constexpr auto HISTORY_HOT_CHUNKS = 4u;
+
+    /// @brief - The number of steps read at once from legacy files.
+    constexpr auto LEGACY_STEPS_PER_READ = 65536u;
+
+    /// @brief - The number of steps decoded in parallel when loading
+    /// encoded steps. Bounds the memory used to hold the decoded
+    /// values before they are added to the history.
+    constexpr auto DECODED_STEPS_PER_BATCH = 262144u;
+
+    /**
+     * @brief - Apply the input function to each index in the range
+     *          `[0, count)`, splitting the indices between as many
+     *          threads as there are cores.
+     * @param count - the number of indices to process.
+     * @param function - the function to apply, should not throw.
+     */
+    template <typename Function>
+    void
+    parallelFor(std::size_t count, Function function) {
+      const std::size_t workers = std::min<std::size_t>(
+        std::max(std::thread::hardware_concurrency(), 1u),
+        count
+      );
+
+      auto process = [&function, count, workers](std::size_t worker) {
+        for (std::size_t id = worker ; id < count ; id += workers) {
+          function(id);
+        }
+      };
+
+      std::vector<std::thread> threads;
+      for (std::size_t worker = 1u ; worker < workers ; ++worker) {
+        threads.emplace_back(process, worker);
+      }
+
+      process(0u);
+
+      for (std::thread& thread : threads) {
+        thread.join();
+      }
+    }
+
+    /// @brief - Compute a throughput in megabytes per second.
+    float
+    throughput(std::size_t bytes, const utils::Duration& d) noexcept {
+      const float seconds = std::chrono::duration<float>(d).count();
+      return (seconds > 0.0f ? bytes / (1024.0f * 1024.0f * seconds) : 0.0f);
+    }
+
     Range
     positiveRange() noexcept {
       return {0.0f, std::numeric_limits<float>::max()};
@@ -27,7 +89,15 @@ namespace eqdif {
 
     m_method(method),
 
-    onSimulationStep()
+    m_tolerance(defaultTolerance()),
+    m_retention(unlimitedRetention()),
+    m_saveCompression(noCompression()),
+
+    m_saveThread(),
+    m_saving(false),
+    m_saveProgress(0.0f),
+
+    onSimulationLoaded()
   {
     setService("eqdif");
     addModule(toString(m_method));
@@ -35,16 +105,29 @@ namespace eqdif {
     initialize();
 
     validate();
+    compile();
+
+    m_channel.reset(m_variableNames.size());
   }
 
   Simulation::~Simulation() {
-    onSimulationStep.disconnectAll();
+    // Wait for the pending saves to complete.
+    stopStreaming();
+    if (m_saveThread.joinable()) {
+      m_saveThread.join();
+    }
+
+    onSimulationLoaded.disconnectAll();
   }
 
   void
   Simulation::load(const std::string& file) {
+    // The steps of the new simulation should not be appended to
+    // the previous save file.
+    stopStreaming();
+
     // Open the file and verify that it is valid.
-    std::ifstream in(file.c_str());
+    std::ifstream in(file.c_str(), std::ios::binary);
     if (!in.good()) {
       error(
         "Failed to load model to \"" + file + "\"",
@@ -52,12 +135,705 @@ namespace eqdif {
       );
     }
 
+    // Binary save files are mapped in memory, older ones are
+    // parsed from the stream.
+    char magic[sizeof(SAVE_FILE_MAGIC)] = {};
+    in.read(magic, sizeof(magic));
+
+    if (in.gcount() == static_cast<std::streamsize>(sizeof(magic)) && std::equal(magic, magic + sizeof(magic), SAVE_FILE_MAGIC)) {
+      in.close();
+      loadBinary(file);
+    }
+    else {
+      in.clear();
+      in.seekg(0);
+      loadLegacy(in);
+    }
+
+    m_history.setRetentionPolicy(m_retention);
+
+    info(
+      "Loaded simulation with " + std::to_string(m_variableNames.size()) +
+      " variable(s) and " + std::to_string(m_history.size()) +
+      " simulation step(s) from " + file
+    );
+
+    validate();
+    compile();
+
+    // The steps of the previous simulation should not be consumed.
+    m_channel.reset(m_variableNames.size());
+
+    onSimulationLoaded.emit(m_history);
+  }
+
+  void
+  Simulation::save(const std::string& file) const {
+    save(file, m_saveCompression);
+  }
+
+  void
+  Simulation::save(const std::string& file, const CompressionPolicy& compression) const {
+    // The streamed file is already kept up to date: replacing it
+    // would also detach the writer from it.
+    if (flushStream(file)) {
+      return;
+    }
+
+    write(file, *snapshot(), compression);
+  }
+
+  bool
+  Simulation::saveAsync(const std::string& file, SaveCallback callback) {
+    if (m_saving) {
+      warn(
+        "Failed to save model to \"" + file + "\"",
+        "Another save is in progress"
+      );
+
+      return false;
+    }
+
+    if (m_saveThread.joinable()) {
+      m_saveThread.join();
+    }
+
+    if (flushStream(file)) {
+      if (callback) {
+        callback(file, true);
+      }
+
+      return true;
+    }
+
+    // Only the snapshot is accessed by the saving thread: the
+    // simulation can keep running while it is written.
+    std::shared_ptr<const Snapshot> data = snapshot();
+    const CompressionPolicy compression = m_saveCompression;
+
+    m_saving = true;
+    m_saveProgress = 0.0f;
+
+    m_saveThread = std::thread(
+      [this, file, data, compression, callback]() {
+        bool success = false;
+        withSafetyNet(
+          [&]() {
+            write(file, *data, compression);
+            success = true;
+          },
+          "saveAsync"
+        );
+
+        m_saving = false;
+
+        if (callback) {
+          callback(file, success);
+        }
+      }
+    );
+
+    return true;
+  }
+
+  bool
+  Simulation::saving() const noexcept {
+    return m_saving;
+  }
+
+  float
+  Simulation::saveProgress() const noexcept {
+    return m_saveProgress;
+  }
+
+  std::shared_ptr<const Simulation::Snapshot>
+  Simulation::snapshot() const {
+    utils::TimeStamp start = utils::now();
+
+    auto out = std::make_shared<Snapshot>(
+      Snapshot{
+        m_method,
+        m_variableNames,
+        m_initialValues,
+        m_ranges,
+        m_system,
+        m_history.snapshot(),
+        m_preview
+      }
+    );
+
+    debug(
+      "Took snapshot of " + std::to_string(out->history.size()) + " simulation step(s) in " +
+      utils::durationToMsString(utils::now() - start)
+    );
+
+    return out;
+  }
+
+  bool
+  Simulation::flushStream(const std::string& file) const {
+    Guard guard(m_writerLocker);
+    if (m_writer == nullptr || m_writer->file() != file) {
+      return false;
+    }
+
+    m_writer->flush();
+    info("Simulation is already streamed to " + file);
+
+    return true;
+  }
+
+  void
+  Simulation::write(const std::string& file,
+                    const Snapshot& data,
+                    const CompressionPolicy& compression) const
+  {
+    // Write to a temporary file which then replaces the save file:
+    // the save file might be mapped by a loaded simulation and it
+    // should not be modified.
+    const std::string temporary = file + ".tmp";
+
+    std::ofstream out(temporary.c_str(), std::ios::binary);
+    if (!out.good()) {
+      error(
+        "Failed to save model to \"" + file + "\"",
+        "Failed to open file"
+      );
+    }
+
+    const Trajectory& history = data.history;
+
+    SaveFileHeader header{};
+    std::copy(SAVE_FILE_MAGIC, SAVE_FILE_MAGIC + sizeof(SAVE_FILE_MAGIC), header.magic);
+    header.version = SAVE_FILE_VERSION;
+    header.method = static_cast<std::uint32_t>(data.method);
+    header.variables = data.variableNames.size();
+    header.encoding = static_cast<std::uint32_t>(compression.encoding);
+
+    // The header is written once the position of each section is
+    // known.
+    SaveFileWriter writer(out);
+    writer.write(header);
+
+    header.previewOffset = writer.offset();
+    writePreview(writer, data.preview);
+    header.previewSize = writer.offset() - header.previewOffset;
+
+    header.modelOffset = writer.offset();
+    writeModel(writer, data.variableNames, data.initialValues, data.ranges, data.system);
+    header.modelSize = writer.offset() - header.modelOffset;
+
+    header.decimatedOffset = writer.offset();
+    writeLevels(writer, history.levels());
+    header.decimatedSize = writer.offset() - header.decimatedOffset;
+
+    // Only the steps at full resolution are saved, one contiguous
+    // range at a time.
+    writer.alignForSteps();
+    header.first = history.first();
+    header.stepsOffset = writer.offset();
+    header.steps = history.size() - history.first();
+
+    const std::size_t rawSize = header.steps * data.variableNames.size() * sizeof(float);
+    utils::TimeStamp start = utils::now();
+
+    std::vector<std::uint8_t> bytes;
+    std::size_t id = history.first();
+    while (id < history.size()) {
+      const std::size_t count = history.contiguous(id);
+      const float* steps = history.step(id);
+      id += count;
+
+      m_saveProgress = 1.0f * (id - history.first()) / std::max<std::size_t>(header.steps, 1u);
+
+      if (compression.encoding == Encoding::Raw) {
+        writer.write(steps, count * data.variableNames.size());
+        continue;
+      }
+
+      // Encoded steps are written in blocks, each variable being
+      // encoded on its own.
+      writer.write(static_cast<std::uint32_t>(count));
+      for (unsigned var = 0u ; var < data.variableNames.size() ; ++var) {
+        bytes.clear();
+        encodeColumn(steps + var, count, data.variableNames.size(), compression, bytes);
+
+        writer.write(static_cast<std::uint64_t>(bytes.size()));
+        writer.write(bytes.data(), bytes.size());
+      }
+    }
+
+    if (compression.encoding != Encoding::Raw) {
+      const utils::Duration d = utils::now() - start;
+      const std::size_t encodedSize = writer.offset() - header.stepsOffset;
+
+      info(
+        "Encoded " + std::to_string(header.steps) + " step(s) with " + toString(compression.encoding) +
+        " in " + utils::durationToMsString(d) + " (" + std::to_string(throughput(rawSize, d)) +
+        " MB/s), compression ratio " + std::to_string(1.0f * rawSize / std::max<std::size_t>(encodedSize, 1u))
+      );
+    }
+
+    out.seekp(0);
+    writer.write(header);
+    out.close();
+
+    if (out.fail()) {
+      std::remove(temporary.c_str());
+      error(
+        "Failed to save model to \"" + file + "\"",
+        "Failed to write data"
+      );
+    }
+
+    if (std::rename(temporary.c_str(), file.c_str()) != 0) {
+      std::remove(temporary.c_str());
+      error(
+        "Failed to save model to \"" + file + "\"",
+        "Failed to replace existing file"
+      );
+    }
+
+    if (history.encodedSteps() > 0u) {
+      const std::size_t encodedRaw = history.encodedSteps() * data.variableNames.size() * sizeof(float);
+      debug(
+        "History holds " + std::to_string(history.encodedSteps()) + " compressed step(s) in " +
+        std::to_string(history.encodedSize()) + " byte(s), compression ratio " +
+        std::to_string(1.0f * encodedRaw / std::max<std::size_t>(history.encodedSize(), 1u))
+      );
+    }
+
+    info(
+      "Saved simulation with " + std::to_string(data.variableNames.size()) +
+      " variable(s) and " + std::to_string(history.size()) +
+      " simulation step(s) to " + file
+    );
+  }
+
+  void
+  Simulation::setCompression(const CompressionPolicy& history, const CompressionPolicy& saves) {
+    m_history.setCompression(history, HISTORY_HOT_CHUNKS);
+    m_saveCompression = saves;
+
+    info(
+      "Compressing history with " + toString(history.encoding) +
+      " and saves with " + toString(saves.encoding)
+    );
+  }
+
+  bool
+  Simulation::stream(const std::string& file,
+                     const StreamingPolicy& policy,
+                     SaveCallback callback)
+  {
+    if (flushStream(file)) {
+      if (callback) {
+        callback(file, true);
+      }
+
+      return true;
+    }
+
+    if (m_saving) {
+      warn(
+        "Failed to stream model to \"" + file + "\"",
+        "Another save is in progress"
+      );
+
+      return false;
+    }
+
+    // The steps are appended to the new file from now on: the
+    // previous one is complete up to this point.
+    stopStreaming();
+
+    // The snapshot is written by the writing thread before it
+    // appends the steps computed in the meantime. New steps can
+    // only be appended to raw steps.
+    std::shared_ptr<const Snapshot> data = snapshot();
+
+    m_saving = true;
+    m_saveProgress = 0.0f;
+
+    auto initializer = [this, file, data, callback]() {
+      bool success = false;
+      withSafetyNet(
+        [&]() {
+          write(file, *data, noCompression());
+          success = true;
+        },
+        "stream"
+      );
+
+      m_saving = false;
+
+      if (callback) {
+        callback(file, success);
+      }
+
+      return success;
+    };
+
+    auto writer = std::make_unique<StepWriter>(file, m_variableNames.size(), policy, initializer);
+
+    {
+      Guard guard(m_writerLocker);
+      m_writer = std::move(writer);
+    }
+
+    info("Streaming simulation steps to " + file);
+
+    return true;
+  }
+
+  void
+  Simulation::stopStreaming() {
+    std::unique_ptr<StepWriter> writer;
+    {
+      Guard guard(m_writerLocker);
+      writer.swap(m_writer);
+    }
+
+    // The remaining steps are written when the writer is destroyed:
+    // this is done without holding the lock so that the simulation
+    // does not wait for the disk.
+    writer.reset();
+  }
+
+  void
+  Simulation::reset() {
+    // The steps after the reset should not be appended to the
+    // save file.
+    stopStreaming();
+
+    info(
+      "Reset " + std::to_string(m_variableNames.size()) +
+      " variable(s) to their initial value, discarding " +
+      std::to_string(m_history.size()) + " existing simulation step(s)"
+    );
+
+    m_history.reset(m_variableNames.size());
+    m_history.reserve(HISTORY_RESERVED_STEPS);
+    m_history.push(m_initialValues.data());
+
+    m_preview.reset(m_variableNames.size());
+    m_preview.add(m_initialValues.data());
+
+    m_channel.reset(m_variableNames.size());
+
+    validate();
+    compile();
+  }
+
+  void
+  Simulation::simulate(const time::Manager& manager) {
+    // Grow the history by one step: this does not allocate as
+    // long as the reserved chunks are not exhausted. Note that
+    // the previous step stays valid when the history grows.
+    const float* current = m_history.back();
+    float* next = m_history.append();
+
+    // Compute the next step directly in the history.
+    m_model->computeNextStep(current, next, manager.lastStepDuration());
+
+    m_preview.add(next);
+
+    {
+      Guard guard(m_writerLocker);
+      if (m_writer != nullptr) {
+        m_writer->append(next);
+      }
+    }
+
+    // The consumer of the steps is never waited for: if it does
+    // not keep up the step is dropped from the channel.
+    m_channel.push(next);
+  }
+
+  void
+  Simulation::setRetentionPolicy(const RetentionPolicy& policy) {
+    m_retention = policy;
+    m_history.setRetentionPolicy(m_retention);
+
+    if (m_retention.fullResolutionSteps > 0u) {
+      info(
+        "Keeping " + std::to_string(m_retention.fullResolutionSteps) +
+        " step(s) at full resolution, older ones are decimated by " +
+        std::to_string(m_retention.decimationFactor)
+      );
+    }
+  }
+
+  void
+  Simulation::setTolerance(const Tolerance& tolerance) {
+    m_tolerance = tolerance;
+    compile();
+
+    info(
+      "Setting tolerance to " + std::to_string(m_tolerance.absolute) +
+      " (absolute) and " + std::to_string(m_tolerance.relative) + " (relative)"
+    );
+  }
+
+  const std::vector<std::string>&
+  Simulation::getVariableNames() const noexcept {
+    return m_variableNames;
+  }
+
+  const Trajectory&
+  Simulation::getHistory() const noexcept {
+    return m_history;
+  }
+
+  StepChannel&
+  Simulation::getStepChannel() noexcept {
+    return m_channel;
+  }
+
+  void
+  Simulation::loadBinary(const std::string& file) {
+    auto mapping = std::make_shared<MappedFile>(file);
+    const char* data = mapping->data();
+    const std::size_t size = mapping->size();
+
+    if (!isSaveFile(data, size)) {
+      error(
+        "Failed to load model from \"" + file + "\"",
+        "File is too small to hold a header"
+      );
+    }
+
+    SaveFileHeader header;
+    if (!readHeader(data, size, header)) {
+      SaveFileHeader raw;
+      std::memcpy(&raw, data, sizeof(raw.magic) + sizeof(raw.version));
+
+      error(
+        "Failed to load model from \"" + file + "\"",
+        "Unsupported version " + std::to_string(raw.version)
+      );
+    }
+
+    // Make sure that all sections are within the file before
+    // reading them.
+    const std::size_t stepSize = header.variables * sizeof(float);
+    const Encoding encoding = static_cast<Encoding>(header.encoding);
+
+    if (encoding != Encoding::Raw && encoding != Encoding::Xor && encoding != Encoding::Delta) {
+      error(
+        "Failed to load model from \"" + file + "\"",
+        "Unsupported encoding " + std::to_string(header.encoding)
+      );
+    }
+
+    // The method is checked before anything is replaced: the model
+    // could not be built with an unknown method.
+    if (header.method > static_cast<std::uint32_t>(SimulationMethod::VELOCITY_VERLET)) {
+      error(
+        "Failed to load model from \"" + file + "\"",
+        "Unsupported simulation method " + std::to_string(header.method)
+      );
+    }
+
+    if (header.modelOffset > size || header.modelSize > size - header.modelOffset ||
+        header.decimatedOffset > size || header.decimatedSize > size - header.decimatedOffset ||
+        header.previewOffset > size || header.previewSize > size - header.previewOffset ||
+        header.stepsOffset > size || header.stepsOffset % alignof(float) != 0u ||
+        (encoding == Encoding::Raw && stepSize > 0u && header.steps > (size - header.stepsOffset) / stepSize))
+    {
+      error(
+        "Failed to load model from \"" + file + "\"",
+        "Sections do not fit in the " + std::to_string(size) + " byte(s) of the file"
+      );
+    }
+
+    SaveFileReader model(data + header.modelOffset, header.modelSize);
+    if (!readModel(model, header.variables, m_variableNames, m_initialValues, m_ranges, m_system)) {
+      error(
+        "Failed to load model from \"" + file + "\"",
+        "Model section is truncated"
+      );
+    }
+
+    std::vector<DecimatedLevel> levels;
+    SaveFileReader decimated(data + header.decimatedOffset, header.decimatedSize);
+    if (!readLevels(decimated, header.variables, levels)) {
+      error(
+        "Failed to load model from \"" + file + "\"",
+        "Decimated section is truncated"
+      );
+    }
+
+    const SimulationMethod method = static_cast<SimulationMethod>(header.method);
+    if (method != m_method) {
+      info("Switching simulation method from " + toString(m_method) + " to " + toString(method));
+      m_method = method;
+    }
+
+    // The retention policy is only applied once the decimated data
+    // has been restored.
+    m_history.reset(header.variables);
+    m_history.setRetentionPolicy(unlimitedRetention());
+
+    if (!m_history.restorable(header.first, levels)) {
+      error(
+        "Failed to load model from \"" + file + "\"",
+        "Decimated section is inconsistent with the first step " + std::to_string(header.first)
+      );
+    }
+
+    if (encoding == Encoding::Raw) {
+      utils::TimeStamp start = utils::now();
+      m_history.assign(mapping, header.stepsOffset, header.steps);
+      const utils::Duration d = utils::now() - start;
+
+      info(
+        "Mapped " + std::to_string(header.steps) + " step(s) from offset " +
+        std::to_string(header.stepsOffset) + " in " + utils::durationToMsString(d) +
+        " (" + std::to_string(throughput(header.steps * stepSize, d)) + " MB/s)"
+      );
+    }
+    else {
+      loadEncodedSteps(mapping, header.stepsOffset, encoding, header.steps, file);
+    }
+
+    m_history.reserve(m_history.size() + HISTORY_RESERVED_STEPS);
+
+    if (!levels.empty()) {
+      m_history.restore(header.first, levels);
+    }
+
+    // Older files do not have a preview: it is computed from the
+    // steps in this case.
+    SaveFileReader preview(data + header.previewOffset, header.previewSize);
+    if (header.previewSize == 0u || !readPreview(preview, header.variables, m_preview)) {
+      m_preview.rebuild(m_history);
+    }
+  }
+
+  void
+  Simulation::loadEncodedSteps(std::shared_ptr<MappedFile> mapping,
+                               std::size_t offset,
+                               const Encoding& encoding,
+                               std::size_t steps,
+                               const std::string& file)
+  {
+    const unsigned variables = m_history.variables();
+    utils::TimeStamp start = utils::now();
+
+    // Index the blocks first: the size of each column is stored in
+    // the file so the blocks can then be decoded independently.
+    SaveFileReader reader(mapping->data() + offset, mapping->size() - offset);
+    std::vector<std::uint32_t> counts;
+    std::vector<const char*> columns;
+    std::vector<std::uint64_t> sizes;
+    std::size_t indexed = 0u;
+
+    while (indexed < steps) {
+      std::uint32_t count = 0u;
+      if (!reader.read(count) || count == 0u || count > steps - indexed) {
+        error(
+          "Failed to load model from \"" + file + "\"",
+          "Invalid block of steps after " + std::to_string(indexed) + " step(s)"
+        );
+      }
+
+      for (unsigned var = 0u ; var < variables ; ++var) {
+        std::uint64_t bytes = 0u;
+        const char* column = nullptr;
+
+        if (!reader.read(bytes) || !reader.view(bytes, column)) {
+          error(
+            "Failed to load model from \"" + file + "\"",
+            "Variable " + std::to_string(var) + " is truncated after " +
+            std::to_string(indexed) + " step(s)"
+          );
+        }
+
+        columns.push_back(column);
+        sizes.push_back(bytes);
+      }
+
+      counts.push_back(count);
+      indexed += count;
+    }
+
+    // Blocks holding a complete chunk are used in place and only
+    // decoded when their steps are accessed.
+    std::size_t block = 0u;
+    while (block < counts.size() && counts[block] == m_history.stepsPerChunk()) {
+      m_history.appendEncoded(mapping, encoding, columns.data() + block * variables, sizes.data() + block * variables);
+      ++block;
+    }
+
+    const std::size_t kept = m_history.size();
+    m_history.reserve(steps);
+
+    // Decode batches of the remaining blocks in parallel and then
+    // add them to the history in order.
+    std::vector<float> batch;
+    std::vector<std::size_t> offsets;
+    std::size_t loaded = kept;
+
+    while (block < counts.size()) {
+      const std::size_t first = block;
+      offsets.clear();
+      offsets.push_back(0u);
+
+      while (block < counts.size() && (block == first || offsets.back() + counts[block] <= DECODED_STEPS_PER_BATCH)) {
+        offsets.push_back(offsets.back() + counts[block]);
+        ++block;
+      }
+
+      batch.resize(offsets.back() * variables);
+
+      std::atomic<bool> failed(false);
+      parallelFor(
+        block - first,
+        [&](std::size_t id) {
+          const std::size_t b = first + id;
+          float* out = batch.data() + offsets[id] * variables;
+
+          for (unsigned var = 0u ; var < variables ; ++var) {
+            const std::size_t column = b * variables + var;
+            if (!decodeColumn(reinterpret_cast<const std::uint8_t*>(columns[column]), sizes[column], encoding, counts[b], variables, out + var)) {
+              failed = true;
+            }
+          }
+        }
+      );
+
+      if (failed) {
+        error(
+          "Failed to load model from \"" + file + "\"",
+          "Failed to decode steps after " + std::to_string(loaded) + " step(s)"
+        );
+      }
+
+      for (std::size_t id = 0u ; id < offsets.back() ; ++id) {
+        m_history.push(batch.data() + id * variables);
+      }
+
+      loaded += offsets.back();
+    }
+
+    const utils::Duration d = utils::now() - start;
+    info(
+      "Kept " + std::to_string(kept) + " step(s) encoded with " + toString(encoding) +
+      " and decoded " + std::to_string(steps - kept) + " step(s) in " + utils::durationToMsString(d) +
+      " (" + std::to_string(throughput((steps - kept) * variables * sizeof(float), d)) + " MB/s)"
+    );
+  }
+
+  void
+  Simulation::loadLegacy(std::istream& in) {
     // Read the number of variables.
     unsigned count = 0u;
     in >> count;
 
     m_variableNames.clear();
     m_initialValues.clear();
+    m_ranges.clear();
     m_system.clear();
 
     // Read all variables.
@@ -81,6 +857,7 @@ namespace eqdif {
 
       m_variableNames.push_back(name);
       m_initialValues.push_back(initialValue);
+      m_ranges.push_back(ra);
 
       eatEndOfLine(in);
 
@@ -140,15 +917,72 @@ namespace eqdif {
     debug("Will read " + std::to_string(count) + " step(s)");
     eatEndOfLine(in);
 
-    m_values.clear();
+    // The retention policy is only applied once all the steps
+    // have been read.
+    m_history.reset(m_variableNames.size());
+    m_history.setRetentionPolicy(unlimitedRetention());
+
+    // Steps are read in large blocks: each of them is expected to
+    // be followed by an end of line.
+    const std::size_t stepSize = m_variableNames.size() * sizeof(float);
+    const std::size_t lineSize = stepSize + 1u;
+
+    // The number of steps can't be trusted before they are read: the
+    // history is only reserved for the steps the file can hold.
+    std::size_t reserved = 0u;
+    const std::streampos begin = in.tellg();
+    if (begin != std::streampos(-1)) {
+      in.seekg(0, std::ios::end);
+      const std::streamoff remaining = in.tellg() - begin;
+      in.seekg(begin);
+
+      reserved = std::min<std::size_t>(count, std::max<std::streamoff>(remaining, 0) / lineSize);
+    }
+    m_history.reserve(reserved + HISTORY_RESERVED_STEPS);
+    std::vector<char> buffer(std::min(count, LEGACY_STEPS_PER_READ) * lineSize);
+    utils::TimeStamp start = utils::now();
+
+    unsigned id = 0u;
+    while (id < count) {
+      const std::size_t steps = std::min(count - id, LEGACY_STEPS_PER_READ);
+      const std::streampos position = in.tellg();
+
+      in.read(buffer.data(), steps * lineSize);
+      const std::size_t available = in.gcount() / lineSize;
+
+      std::size_t parsed = 0u;
+      while (parsed < available && buffer[parsed * lineSize + stepSize] == '\n') {
+        std::memcpy(m_history.append(), buffer.data() + parsed * lineSize, stepSize);
+        ++parsed;
+      }
+
+      id += parsed;
+      if (parsed == steps) {
+        continue;
+      }
 
-    for (unsigned id = 0u ; id < count ; ++id) {
-      std::vector<float> step;
+      // The step is not followed by an end of line or the file is
+      // truncated: read it on its own from the stream.
+      if (position != std::streampos(-1)) {
+        in.clear();
+        in.seekg(position + static_cast<std::streamoff>(parsed * lineSize));
+      }
+
+      if (in.peek() == std::char_traits<char>::eof()) {
+        warn(
+          "File is truncated after " + std::to_string(id) + " step(s) out of " +
+          std::to_string(count)
+        );
+
+        break;
+      }
+
+      float* step = m_history.append();
 
       for (unsigned val = 0u ; val < m_variableNames.size() ; ++val) {
         float value = 0.0f;
         in.read(reinterpret_cast<char*>(&value), sizeof(float));
-        step.push_back(value);
+        step[val] = value;
       }
 
       // Read the rest of the line.
@@ -163,153 +997,16 @@ namespace eqdif {
         );
       }
 
-      m_values.push_back(step);
+      ++id;
     }
 
+    const utils::Duration d = utils::now() - start;
     info(
-      "Loaded simulation with " + std::to_string(m_variableNames.size()) +
-      " variable(s) and " + std::to_string(m_values.size()) +
-      " simulation step(s) from " + file
+      "Read " + std::to_string(id) + " step(s) in " + utils::durationToMsString(d) +
+      " (" + std::to_string(throughput(id * stepSize, d)) + " MB/s)"
     );
 
-    validate();
-  }
-
-  void
-  Simulation::save(const std::string& file) const {
-    // Open the file and verify that it is valid.
-    std::ofstream out(file.c_str());
-    if (!out.good()) {
-      error(
-        "Failed to save model to \"" + file + "\"",
-        "Failed to open file"
-      );
-    }
-
-    // Save the number of variables.
-    out << m_variableNames.size() << std::endl;
-
-    float bufF, sizeF = sizeof(float);
-    const char* rawF = reinterpret_cast<const char*>(&bufF);
-
-    unsigned bufU, sizeU = sizeof(unsigned);
-    const char* rawU = reinterpret_cast<const char*>(&bufU);
-
-    // Save the name of each variable along its initial value.
-    for (unsigned id = 0u ; id < m_variableNames.size() ; ++id) {
-      out << m_variableNames[id] << std::endl;
-      out << m_initialValues[id] << std::endl;
-
-      // Save the range for this variable.
-      out << m_ranges[id].first << std::endl;
-      out << m_ranges[id].second << std::endl;
-
-      // Save the equation for this variable.
-      const Equation& eq = m_system[id];
-
-      bufU = eq.order;
-      out.write(rawU, sizeU);
-
-      bufU = eq.coeffs.size();
-      out.write(rawU, sizeU);
-
-      for (unsigned coeff = 0u ; coeff < eq.coeffs.size() ; ++coeff) {
-        // Save the coefficients.
-        const SingleCoefficient& sf = eq.coeffs[coeff];
-
-        bufF = sf.value;
-        out.write(rawF, sizeF);
-
-        bufU = sf.dependencies.size();
-        out.write(rawU, sizeU);
-
-        for (unsigned sfId = 0u ; sfId < sf.dependencies.size() ; ++sfId) {
-          bufU = sf.dependencies[sfId].id;
-          out.write(rawU, sizeU);
-
-          bufF = sf.dependencies[sfId].n;
-          out.write(rawF, sizeF);
-        }
-      }
-
-      out << std::endl;
-    }
-
-    // Save the number of simulation values.
-    out << m_values.size() << std::endl;
-
-    // And then each simulation values.
-    for (unsigned id = 0u ; id < m_values.size() ; ++id) {
-      const std::vector<float>& step = m_values[id];
-
-      for (unsigned val = 0u ; val < step.size() ; ++val) {
-        bufF = step[val];
-        out.write(rawF, sizeF);
-      }
-
-      out << std::endl;
-    }
-
-    info(
-      "Saving simulation with " + std::to_string(m_variableNames.size()) +
-      " variable(s) and " + std::to_string(m_values.size()) +
-      " simulation step(s) to " + file
-    );
-  }
-
-  void
-  Simulation::reset() {
-    info(
-      "Reset " + std::to_string(m_variableNames.size()) +
-      " variable(s) to their initial value, discarding " +
-      std::to_string(m_values.size()) + " existing simulation step(s)"
-    );
-
-    m_values = {m_initialValues};
-
-    validate();
-  }
-
-  void
-  Simulation::simulate(const time::Manager& manager) {
-    SimulationData data{
-      m_system,                  // system
-
-      m_variableNames,           // names
-      m_ranges,                  // ranges
-
-      m_values.back(),           // vals
-
-      m_method,                  // method
-      manager.lastStepDuration() // tDelta
-    };
-
-    Model model(data);
-    auto nextStep = model.computeNextStep();
-    if (nextStep.size() != m_variableNames.size()) {
-      error(
-        "Failed to generate values for all " + std::to_string(m_variableNames.size()) +
-        " variable(s) for step " + std::to_string(m_values.size()),
-        "Only " + std::to_string(nextStep.size()) +
-        " value(s) were generated"
-      );
-    }
-
-    verbose(
-      "Generated " + std::to_string(nextStep.size()) +
-      " value(s) for step step " + std::to_string(m_values.size()) +
-      " lasting " + std::to_string(manager.lastStepDuration(time::Unit::Millisecond)) +
-      "ms"
-    );
-
-    m_values.push_back(nextStep);
-
-    onSimulationStep.emit(nextStep);
-  }
-
-  const std::vector<std::string>&
-  Simulation::getVariableNames() const noexcept {
-    return m_variableNames;
+    m_preview.rebuild(m_history);
   }
 
   void
@@ -443,7 +1140,12 @@ namespace eqdif {
     m_system.push_back(eq);
 # endif
 
-    m_values.push_back(m_initialValues);
+    m_history.reset(m_variableNames.size());
+    m_history.reserve(HISTORY_RESERVED_STEPS);
+    m_history.push(m_initialValues.data());
+
+    m_preview.reset(m_variableNames.size());
+    m_preview.add(m_initialValues.data());
   }
 
   void
@@ -496,7 +1198,7 @@ namespace eqdif {
         const SingleCoefficient& coeff = eq.coeffs[sf];
 
         for (unsigned dep = 0u ; dep < coeff.dependencies.size() ; ++dep) {
-          if (coeff.dependencies[dep].id > m_variableNames.size()) {
+          if (coeff.dependencies[dep].id >= m_variableNames.size()) {
             error(
               "Dependency for variable " + m_variableNames[eqId] + " requires " +
               std::to_string(coeff.dependencies[dep].id) + " variable(s) when only " +
@@ -507,18 +1209,31 @@ namespace eqdif {
       }
     }
 
-    for (unsigned id = 0u ; id < m_values.size() ; ++id) {
-      auto valuesForStep = m_values[id].size();
+    if (varsCount != m_history.variables()) {
+      error(
+        "Mismatch between defined variables and steps",
+        "Steps define " + std::to_string(m_history.variables()) +
+        " value(s) but " + std::to_string(varsCount) +
+        " variable(s) are defined"
+      );
+    }
+  }
 
-      if (varsCount != valuesForStep) {
-        error(
-          "Mismatch between defined variables and steps",
-          "Step " + std::to_string(id) + " defines " +
-          std::to_string(valuesForStep) + " value(s) but " +
-          std::to_string(varsCount) + " variable(s) are defined"
-        );
-      }
+  void
+  Simulation::compile() {
+    m_model = std::make_unique<Model>(m_system, m_ranges, m_method, m_tolerance);
+
+    // Resume from the last steps of the history if possible.
+    if (m_history.size() >= m_history.first() + 2u) {
+      m_model->resume(m_history.step(m_history.size() - 2u));
     }
+
+    const CompiledSystem& compiled = m_model->system();
+    debug(
+      "Compiled system with " + std::to_string(compiled.size()) +
+      " equation(s), " + std::to_string(compiled.terms()) + " term(s) and " +
+      std::to_string(compiled.monomials()) + " distinct monomial(s)"
+    );
   }
 
 }
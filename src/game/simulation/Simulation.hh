@@ -1,14 +1,28 @@
 #ifndef    SIMULATION_HH
 # define   SIMULATION_HH
 
+# include <mutex>
+# include <atomic>
+# include <thread>
 # include <vector>
+# include <memory>
+# include <functional>
 # include <core_utils/CoreObject.hh>
 # include <core_utils/Signal.hh>
 # include "Launcher.hh"
 # include "Model.hh"
+# include "Trajectory.hh"
+# include "Preview.hh"
+# include "StepWriter.hh"
+# include "StepChannel.hh"
 
 namespace eqdif {
 
+  /// @brief - Notified when a save completes, with the path to the
+  /// save file and whether it succeeded. Called from the thread
+  /// writing the file.
+  using SaveCallback = std::function<void(const std::string&, bool)>;
+
   class Simulation: public utils::CoreObject, public Process {
     public:
 
@@ -22,17 +36,208 @@ namespace eqdif {
       void
       save(const std::string& file) const;
 
+      /**
+       * @brief - Save the simulation to the input file in the
+       *          background. A snapshot of the simulation is taken
+       *          and written by a dedicated thread so that the
+       *          simulation can keep running in the meantime. Only
+       *          one save can be in progress at a time.
+       * @param file - the path to the save file.
+       * @param callback - notified when the save completes.
+       * @return - `false` if another save is in progress, in which
+       *           case nothing is saved.
+       */
+      bool
+      saveAsync(const std::string& file, SaveCallback callback = SaveCallback());
+
+      /**
+       * @brief - Whether a save is being written in the background.
+       * @return - `true` if a save is in progress.
+       */
+      bool
+      saving() const noexcept;
+
+      /**
+       * @brief - The fraction of the steps already written by the
+       *          save in progress, or by the last one.
+       * @return - the progress of the save between `0` and `1`.
+       */
+      float
+      saveProgress() const noexcept;
+
+      /**
+       * @brief - Define how the steps are compressed, both for the
+       *          old steps of the history and in the save files.
+       *          Note that the steps of streamed save files are
+       *          never compressed as new steps are appended to them.
+       * @param history - how to compress the old steps of the history.
+       * @param saves - how to compress the steps in save files.
+       */
+      void
+      setCompression(const CompressionPolicy& history, const CompressionPolicy& saves);
+
+      /**
+       * @brief - Save the simulation to the input file and then keep
+       *          appending the new steps to it in the background as
+       *          they are computed. The file is written from a
+       *          snapshot by the writing thread, as `saveAsync` does.
+       *          If the simulation is already streamed to another file
+       *          the steps stop being appended to it. If it is already
+       *          streamed to the input file the buffered steps are
+       *          flushed instead.
+       * @param file - the path to the save file.
+       * @param policy - when to write the buffered steps.
+       * @param callback - notified when the initial save completes.
+       * @return - `false` if another save is in progress, in which
+       *           case nothing is saved.
+       */
+      bool
+      stream(const std::string& file,
+             const StreamingPolicy& policy,
+             SaveCallback callback = SaveCallback());
+
+      /**
+       * @brief - Stop appending the steps to the save file if the
+       *          simulation is streamed. Nothing happens otherwise.
+       */
+      void
+      stopStreaming();
+
       void
       reset();
 
       void
       simulate(const time::Manager& manager) override;
 
+      /**
+       * @brief - Define how much of the history is kept at full
+       *          resolution. Older steps are decimated.
+       * @param policy - the retention policy.
+       */
+      void
+      setRetentionPolicy(const RetentionPolicy& policy);
+
+      /**
+       * @brief - Define the error allowed on each step by adaptive
+       *          and implicit simulation methods. The model is
+       *          rebuilt so that the integration restarts from the
+       *          last step.
+       * @param tolerance - the error allowed on each step.
+       */
+      void
+      setTolerance(const Tolerance& tolerance);
+
       const std::vector<std::string>&
       getVariableNames() const noexcept;
 
+      /**
+       * @brief - Return the values reached by the variables at each
+       *          step of the simulation.
+       * @return - the history of the simulation.
+       */
+      const Trajectory&
+      getHistory() const noexcept;
+
+      /**
+       * @brief - Return the channel receiving each new step of the
+       *          simulation. It is meant to be drained regularly by
+       *          a single consumer thread, typically the one which
+       *          displays the steps. The channel is reset whenever
+       *          the simulation is reset or loaded.
+       * @return - the channel of simulation steps.
+       */
+      StepChannel&
+      getStepChannel() noexcept;
+
     private:
 
+      /// @brief - A copy of the state of the simulation which can be
+      /// saved while the simulation keeps running.
+      struct Snapshot {
+        SimulationMethod method;
+        std::vector<std::string> variableNames;
+        std::vector<float> initialValues;
+        std::vector<Range> ranges;
+        System system;
+        Trajectory history;
+        Preview preview;
+      };
+
+      /**
+       * @brief - Save the simulation to the input file.
+       * @param file - the path to the save file.
+       * @param compression - how to compress the steps.
+       */
+      void
+      save(const std::string& file, const CompressionPolicy& compression) const;
+
+      /**
+       * @brief - Take a snapshot of the simulation. The history of
+       *          the snapshot shares its complete chunks with the
+       *          history of the simulation so this is cheap.
+       * @return - the snapshot.
+       */
+      std::shared_ptr<const Snapshot>
+      snapshot() const;
+
+      /**
+       * @brief - Flush the steps buffered by the writer in case the
+       *          simulation is streamed to the input file.
+       * @param file - the path to the save file.
+       * @return - `true` if the simulation is streamed to the file.
+       */
+      bool
+      flushStream(const std::string& file) const;
+
+      /**
+       * @brief - Write a snapshot of the simulation to the input file.
+       *          The file is first written to a temporary file which
+       *          then replaces it. Raises an error in case of failure.
+       * @param file - the path to the save file.
+       * @param data - the snapshot to write.
+       * @param compression - how to compress the steps.
+       */
+      void
+      write(const std::string& file,
+            const Snapshot& data,
+            const CompressionPolicy& compression) const;
+
+      /**
+       * @brief - Load a simulation saved in the binary format. The
+       *          file is mapped in memory and the steps are used in
+       *          place as the history.
+       * @param file - the path to the save file.
+       */
+      void
+      loadBinary(const std::string& file);
+
+      /**
+       * @brief - Add the compressed steps of a save file to the
+       *          history. Blocks holding a complete chunk are kept
+       *          encoded in the mapped file and only decoded when
+       *          accessed, the others are decoded right away.
+       * @param mapping - the mapped save file.
+       * @param offset - the offset of the steps section in the file.
+       * @param encoding - the encoding of the steps.
+       * @param steps - the number of steps to load.
+       * @param file - the path to the save file, used for errors.
+       */
+      void
+      loadEncodedSteps(std::shared_ptr<MappedFile> mapping,
+                       std::size_t offset,
+                       const Encoding& encoding,
+                       std::size_t steps,
+                       const std::string& file);
+
+      /**
+       * @brief - Load a simulation saved in the legacy format, which
+       *          mixes text and binary data.
+       * @param in - the stream to read from, positioned at the start
+       *             of the file.
+       */
+      void
+      loadLegacy(std::istream& in);
+
       /**
        * @brief - Initialize the simulation.
        *
@@ -47,8 +252,20 @@ namespace eqdif {
       void
       validate();
 
+      /**
+       * @brief - Used to build the model used to compute the steps
+       *          of the simulation from the system. This should be
+       *          called whenever the system changes or when the
+       *          simulation is reset.
+       */
+      void
+      compile();
+
     private:
 
+      /// @brief - Convenience define for a lock guard.
+      using Guard = std::lock_guard<std::mutex>;
+
       /// @brief - The simulation method: used to determine how
       /// to compute the next step of the variables.
       SimulationMethod m_method;
@@ -66,17 +283,60 @@ namespace eqdif {
       /// on each of the other variables.
       System m_system;
 
+      /// @brief - The model used to compute the steps: it holds the
+      /// compiled version of the system and the integrator. It is
+      /// kept for as long as the system does not change.
+      std::unique_ptr<Model> m_model;
+
       /// @brief - The values of the variables for each
       /// timestamp.
-      std::vector<std::vector<float>> m_values;
+      Trajectory m_history;
+
+      /// @brief - A downsampled version of the whole history, updated
+      /// with each step and stored in the save files.
+      Preview m_preview;
+
+      /// @brief - The error allowed on each step by the adaptive and
+      /// implicit simulation methods.
+      Tolerance m_tolerance;
+
+      /// @brief - The retention policy of the history.
+      RetentionPolicy m_retention;
+
+      /// @brief - How the steps are compressed in save files.
+      CompressionPolicy m_saveCompression;
+
+      /// @brief - Transfers the new steps to the consumer thread
+      /// without blocking the simulation.
+      StepChannel m_channel;
+
+      /// @brief - Appends the steps to a save file when the simulation
+      /// is streamed, `null` otherwise.
+      std::unique_ptr<StepWriter> m_writer;
+
+      /// @brief - Protects the writer which is used by the simulation
+      /// thread and replaced by the thread requesting the saves.
+      mutable std::mutex m_writerLocker;
+
+      /// @brief - The thread writing the last save started with the
+      /// `saveAsync` method.
+      std::thread m_saveThread;
+
+      /// @brief - Whether a save is being written in the background,
+      /// either by the saving thread or by the writer.
+      std::atomic<bool> m_saving;
+
+      /// @brief - The fraction of the steps written by the save in
+      /// progress.
+      mutable std::atomic<float> m_saveProgress;
 
     public:
 
       /**
-       * @brief - Signal which notifies that a new simulation step
-       *          has been computed.
+       * @brief - Signal which notifies that a simulation has been
+       *          loaded from a file, along with its history.
       */
-      utils::Signal<const std::vector<float>&> onSimulationStep;
+      utils::Signal<const Trajectory&> onSimulationLoaded;
   };
 
 }
@@ -0,0 +1,68 @@
+
+# include "StepChannel.hh"
+# include <algorithm>
+
+namespace eqdif {
+
+  StepChannel::StepChannel(unsigned variables, std::size_t capacity):
+    m_variables(0u),
+    m_capacity(1u),
+    m_records(),
+
+    m_head(0u),
+    m_tail(0u),
+    m_dropped(0u)
+  {
+    // The capacity is a power of two so that the position of a
+    // step is obtained with a mask.
+    while (m_capacity < capacity) {
+      m_capacity *= 2u;
+    }
+
+    reset(variables);
+  }
+
+  void
+  StepChannel::reset(unsigned variables) {
+    m_variables = variables;
+    m_records.resize(m_capacity * m_variables);
+
+    m_head = 0u;
+    m_tail = 0u;
+    m_dropped = 0u;
+  }
+
+  unsigned
+  StepChannel::variables() const noexcept {
+    return m_variables;
+  }
+
+  std::size_t
+  StepChannel::dropped() const noexcept {
+    return m_dropped.load(std::memory_order_relaxed);
+  }
+
+  bool
+  StepChannel::push(const float* step) noexcept {
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    const std::size_t tail = m_tail.load(std::memory_order_acquire);
+
+    if (head - tail >= m_capacity) {
+      m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+      return false;
+    }
+
+    std::copy(step, step + m_variables, m_records.data() + (head & (m_capacity - 1u)) * m_variables);
+
+    // Publish the step to the consumer.
+    m_head.store(head + 1u, std::memory_order_release);
+
+    return true;
+  }
+
+  void
+  StepChannel::clear() noexcept {
+    m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+}
@@ -0,0 +1,127 @@
+#ifndef    STEP_CHANNEL_HH
+# define   STEP_CHANNEL_HH
+
+# include <atomic>
+# include <vector>
+# include <cstddef>
+
+namespace eqdif {
+
+  /// @brief - The default number of steps which can be held by a
+  /// channel before new steps are dropped.
+  constexpr auto DEFAULT_STEP_CHANNEL_CAPACITY = 4096u;
+
+  /// @brief - A lock-free ring buffer transferring the steps of a
+  /// simulation from the thread computing them to a single thread
+  /// consuming them, typically the one rendering the application.
+  /// The producer never waits: when the consumer does not keep up
+  /// and the buffer is full, the new steps are dropped and counted.
+  ///
+  /// Each side only writes its own index, published with release
+  /// semantics, and the indices live on separate cache lines so
+  /// that the two threads do not contend on them.
+  class StepChannel {
+    public:
+
+      /**
+       * @brief - Create a new empty channel.
+       * @param variables - the number of variables of each step.
+       * @param capacity - the number of steps which can be held, it
+       *                   is rounded up to a power of two.
+       */
+      explicit
+      StepChannel(unsigned variables = 0u,
+                  std::size_t capacity = DEFAULT_STEP_CHANNEL_CAPACITY);
+
+      StepChannel(const StepChannel&) = delete;
+
+      StepChannel&
+      operator=(const StepChannel&) = delete;
+
+      /**
+       * @brief - Remove all the steps and define the number of
+       *          variables of the new ones. This should only be
+       *          called while neither the producer nor the consumer
+       *          use the channel.
+       * @param variables - the number of variables of each step.
+       */
+      void
+      reset(unsigned variables);
+
+      /**
+       * @brief - The number of variables in each step.
+       * @return - the number of variables.
+       */
+      unsigned
+      variables() const noexcept;
+
+      /**
+       * @brief - The number of steps dropped because the channel was
+       *          full since it was last reset.
+       * @return - the number of dropped steps.
+       */
+      std::size_t
+      dropped() const noexcept;
+
+      /**
+       * @brief - Add a copy of a step to the channel. Should only be
+       *          called by the producer.
+       * @param step - the `variables()` values of the step.
+       * @return - `false` if the channel is full, in which case the
+       *           step is dropped.
+       */
+      bool
+      push(const float* step) noexcept;
+
+      /**
+       * @brief - Consume all the steps available in the channel, in
+       *          the order they were pushed. Should only be called by
+       *          the consumer.
+       * @param consumer - called with the values of each step, which
+       *                   are only valid during the call.
+       * @return - the number of steps consumed.
+       */
+      template <typename Consumer>
+      std::size_t
+      drain(Consumer consumer);
+
+      /**
+       * @brief - Discard all the steps available in the channel. Should
+       *          only be called by the consumer.
+       */
+      void
+      clear() noexcept;
+
+    private:
+
+      /// @brief - The size of a cache line, used to keep the indices
+      /// written by each thread apart.
+      static constexpr std::size_t CACHE_LINE_SIZE = 64u;
+
+      /// @brief - The number of variables in each step.
+      unsigned m_variables;
+
+      /// @brief - The number of steps which can be held, a power of two.
+      std::size_t m_capacity;
+
+      /// @brief - The values of the steps, `capacity x variables`.
+      std::vector<float> m_records;
+
+      /// @brief - The number of steps pushed, only written by the
+      /// producer.
+      alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_head;
+
+      /// @brief - The number of steps consumed, only written by the
+      /// consumer.
+      alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_tail;
+
+      /// @brief - The number of steps dropped, only written by the
+      /// producer.
+      alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_dropped;
+  };
+
+}
+
+# include "StepChannel.hxx"
+
+#endif    /* STEP_CHANNEL_HH */
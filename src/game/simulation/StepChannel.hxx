@@ -0,0 +1,29 @@
+#ifndef    STEP_CHANNEL_HXX
+# define   STEP_CHANNEL_HXX
+
+# include "StepChannel.hh"
+
+namespace eqdif {
+
+  template <typename Consumer>
+  inline
+  std::size_t
+  StepChannel::drain(Consumer consumer) {
+    // Only the steps published when starting are consumed: the ones
+    // pushed in the meantime are left for the next call.
+    const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    const std::size_t head = m_head.load(std::memory_order_acquire);
+
+    for (std::size_t id = tail ; id < head ; ++id) {
+      consumer(m_records.data() + (id & (m_capacity - 1u)) * m_variables);
+    }
+
+    // Release the records to the producer once they are consumed.
+    m_tail.store(head, std::memory_order_release);
+
+    return head - tail;
+  }
+
+}
+
+#endif    /* STEP_CHANNEL_HXX */
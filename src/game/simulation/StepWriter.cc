@@ -0,0 +1,227 @@
+
+# include "StepWriter.hh"
+# include <cstddef>
+# include <algorithm>
+# include "SaveFile.hh"
+
+namespace eqdif {
+
+  StepWriter::StepWriter(const std::string& file,
+                         unsigned variables,
+                         const StreamingPolicy& policy,
+                         Initializer initializer):
+    utils::CoreObject("writer"),
+
+    m_file(file),
+    m_variables(variables),
+    m_policy(policy),
+    m_initializer(std::move(initializer)),
+    m_out(),
+    m_stepsOffset(0u),
+    m_steps(0u),
+    m_previewOffset(0u),
+    m_preview(variables),
+
+    m_locker(),
+    m_notifier(),
+    m_pending(),
+    m_flushRequested(false),
+    m_stopRequested(false),
+    m_thread()
+  {
+    setService("eqdif");
+    addModule(file);
+
+    m_policy.blockSteps = std::max(m_policy.blockSteps, 1u);
+
+    // Twice the size of a block so that the simulation can keep
+    // adding steps while the previous block is being written.
+    m_pending.reserve(2u * m_policy.blockSteps * m_variables);
+
+    m_thread = std::thread(&StepWriter::asynchronousWritingLoop, this);
+  }
+
+  StepWriter::~StepWriter() {
+    {
+      UniqueGuard guard(m_locker);
+      m_stopRequested = true;
+    }
+
+    m_notifier.notify_one();
+    m_thread.join();
+
+    info("Streamed " + std::to_string(m_steps) + " step(s) to " + m_file);
+  }
+
+  const std::string&
+  StepWriter::file() const noexcept {
+    return m_file;
+  }
+
+  void
+  StepWriter::append(const float* step) {
+    bool full = false;
+
+    {
+      UniqueGuard guard(m_locker);
+      m_pending.insert(m_pending.end(), step, step + m_variables);
+      full = (m_pending.size() >= m_policy.blockSteps * m_variables);
+    }
+
+    if (full) {
+      m_notifier.notify_one();
+    }
+  }
+
+  void
+  StepWriter::flush() {
+    {
+      UniqueGuard guard(m_locker);
+      m_flushRequested = true;
+    }
+
+    m_notifier.notify_one();
+  }
+
+  void
+  StepWriter::open() {
+    m_out.open(m_file.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    char data[sizeof(SaveFileHeader)] = {};
+    m_out.read(data, sizeof(data));
+
+    SaveFileHeader header;
+    if (!m_out.good() || !readHeader(data, sizeof(data), header)) {
+      warn(
+        "Failed to stream steps to \"" + m_file + "\"",
+        "File is not a valid save file"
+      );
+
+      m_out.setstate(std::ios::failbit);
+      return;
+    }
+
+    if (header.variables != m_variables) {
+      warn(
+        "Failed to stream steps to \"" + m_file + "\"",
+        "File defines " + std::to_string(header.variables) + " variable(s) but steps have " +
+        std::to_string(m_variables)
+      );
+
+      m_out.setstate(std::ios::failbit);
+      return;
+    }
+
+    if (header.encoding != static_cast<std::uint32_t>(Encoding::Raw)) {
+      warn(
+        "Failed to stream steps to \"" + m_file + "\"",
+        "Steps are encoded with " + toString(static_cast<Encoding>(header.encoding)) +
+        ", only raw steps can be appended"
+      );
+
+      m_out.setstate(std::ios::failbit);
+      return;
+    }
+
+    m_stepsOffset = header.stepsOffset;
+    m_steps = header.steps;
+
+    // The preview is kept up to date if the file has one.
+    if (header.previewSize == 0u) {
+      return;
+    }
+
+    std::vector<char> preview(header.previewSize);
+    m_out.seekg(header.previewOffset);
+    m_out.read(preview.data(), preview.size());
+
+    SaveFileReader reader(preview.data(), preview.size());
+    if (!m_out.good() || !readPreview(reader, m_variables, m_preview)) {
+      warn("Failed to read preview from \"" + m_file + "\", it will not be updated");
+
+      m_out.clear();
+      return;
+    }
+
+    m_previewOffset = header.previewOffset;
+  }
+
+  void
+  StepWriter::asynchronousWritingLoop() {
+    // Steps are buffered while the file is created.
+    if (m_initializer && !m_initializer()) {
+      m_out.setstate(std::ios::failbit);
+    }
+    else {
+      open();
+    }
+
+    // The block being written: swapped with the pending steps so
+    // that the lock is not held while writing.
+    std::vector<float> block;
+    block.reserve(m_pending.capacity());
+
+    bool done = false;
+    while (!done) {
+      {
+        UniqueGuard guard(m_locker);
+        m_notifier.wait_for(
+          guard,
+          m_policy.flushInterval,
+          [this]() {
+            return m_stopRequested || m_flushRequested ||
+                   m_pending.size() >= m_policy.blockSteps * m_variables;
+          }
+        );
+
+        block.swap(m_pending);
+        m_flushRequested = false;
+        done = m_stopRequested;
+      }
+
+      if (!block.empty()) {
+        write(block);
+        block.clear();
+      }
+    }
+  }
+
+  void
+  StepWriter::write(const std::vector<float>& values) {
+    if (m_out.fail()) {
+      return;
+    }
+
+    // Write the steps first and then the count in the header: if
+    // the program stops in between the file is still consistent.
+    // Steps are written right after the ones accounted for in the
+    // header, overwriting any incomplete block.
+    m_out.seekp(m_stepsOffset + m_steps * m_variables * sizeof(float));
+    m_out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+    m_out.flush();
+
+    m_steps += values.size() / m_variables;
+
+    if (m_previewOffset > 0u) {
+      for (std::size_t id = 0u ; id < values.size() ; id += m_variables) {
+        m_preview.add(values.data() + id);
+      }
+
+      SaveFileWriter writer(m_out);
+      m_out.seekp(m_previewOffset);
+      writePreview(writer, m_preview);
+    }
+
+    m_out.seekp(offsetof(SaveFileHeader, steps));
+    m_out.write(reinterpret_cast<const char*>(&m_steps), sizeof(m_steps));
+    m_out.flush();
+
+    if (m_out.fail()) {
+      warn(
+        "Failed to stream steps to \"" + m_file + "\"",
+        "Failed to write " + std::to_string(values.size() / m_variables) +
+        " step(s), no more steps will be written"
+      );
+    }
+  }
+
+}
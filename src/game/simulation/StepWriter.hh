@@ -0,0 +1,177 @@
+#ifndef    STEP_WRITER_HH
+# define   STEP_WRITER_HH
+
+# include <mutex>
+# include <thread>
+# include <vector>
+# include <cstdint>
+# include <fstream>
+# include <functional>
+# include <condition_variable>
+# include <core_utils/CoreObject.hh>
+# include <core_utils/TimeUtils.hh>
+# include "Preview.hh"
+
+namespace eqdif {
+
+  /// @brief - Defines when the steps buffered by a writer are
+  /// persisted to disk: whichever threshold is reached first
+  /// triggers a flush.
+  struct StreamingPolicy {
+    /// @brief - The number of steps after which a block is written.
+    unsigned blockSteps;
+
+    /// @brief - The maximum duration during which steps can stay
+    /// in memory before being written.
+    utils::Duration flushInterval;
+  };
+
+  /// @brief - Appends the steps of a running simulation to a save
+  /// file in the background. The file should be a valid save file
+  /// as produced by `Simulation::save` with steps which are not
+  /// compressed: the steps section being the
+  /// last one, new steps are written at the end of the file and the
+  /// number of steps in the header is updated after each block, along
+  /// with the preview section. In case of a crash at most one block
+  /// of steps is lost.
+  ///
+  /// Steps are buffered by the simulation thread and written by an
+  /// internal thread so that the simulation never waits for the
+  /// disk. The save file itself can be created by the internal
+  /// thread before the first steps are written.
+  class StepWriter: public utils::CoreObject {
+    public:
+
+      /// @brief - Creates the save file before steps are appended
+      /// to it, returns `false` in case of failure.
+      using Initializer = std::function<bool()>;
+
+      /**
+       * @brief - Start the writing thread, which creates the save
+       *          file with the initializer if any and opens it. In
+       *          case the file can't be created or opened a warning
+       *          is displayed and the steps are discarded.
+       * @param file - the save file to append steps to.
+       * @param variables - the number of variables in each step.
+       * @param policy - when to write the buffered steps.
+       * @param initializer - creates the save file.
+       */
+      StepWriter(const std::string& file,
+                 unsigned variables,
+                 const StreamingPolicy& policy,
+                 Initializer initializer = Initializer());
+
+      /**
+       * @brief - Write the remaining steps and stop the writing
+       *          thread.
+       */
+      ~StepWriter();
+
+      /**
+       * @brief - The file steps are appended to.
+       * @return - the path to the file.
+       */
+      const std::string&
+      file() const noexcept;
+
+      /**
+       * @brief - Add a step to the buffer of steps to write. This
+       *          does not allocate memory as long as the writing
+       *          thread keeps up with the simulation.
+       * @param step - the values of the step.
+       */
+      void
+      append(const float* step);
+
+      /**
+       * @brief - Request the buffered steps to be written without
+       *          waiting for the thresholds of the policy.
+       */
+      void
+      flush();
+
+    private:
+
+      /**
+       * @brief - Open the save file and verify that steps can be
+       *          appended to it. The stream is left in a failed state
+       *          otherwise.
+       */
+      void
+      open();
+
+      /**
+       * @brief - Executed by the writing thread: wait for steps to
+       *          be available and write them.
+       */
+      void
+      asynchronousWritingLoop();
+
+      /**
+       * @brief - Write a block of steps at the end of the file and
+       *          update the preview and the header accordingly.
+       * @param values - the values of the steps to write.
+       */
+      void
+      write(const std::vector<float>& values);
+
+    private:
+
+      /// @brief - Convenience define for a unique lock.
+      using UniqueGuard = std::unique_lock<std::mutex>;
+
+      /// @brief - The path to the save file.
+      std::string m_file;
+
+      /// @brief - The number of variables in each step.
+      unsigned m_variables;
+
+      /// @brief - When to write buffered steps.
+      StreamingPolicy m_policy;
+
+      /// @brief - Creates the save file, called by the writing thread.
+      Initializer m_initializer;
+
+      /// @brief - The stream to the save file. Only accessed by the
+      /// writing thread once it is started.
+      std::fstream m_out;
+
+      /// @brief - The position of the steps section in the file.
+      std::uint64_t m_stepsOffset;
+
+      /// @brief - The number of steps in the steps section of the
+      /// file. Only accessed by the writing thread.
+      std::uint64_t m_steps;
+
+      /// @brief - The position of the preview section in the file, `0`
+      /// if the file does not have one.
+      std::uint64_t m_previewOffset;
+
+      /// @brief - The preview of the file, updated with the steps which
+      /// are written. Only accessed by the writing thread.
+      Preview m_preview;
+
+      /// @brief - Protects the buffer of pending steps and the flags
+      /// used to communicate with the writing thread.
+      std::mutex m_locker;
+
+      /// @brief - Used to wake up the writing thread when a block is
+      /// ready or when it should stop.
+      std::condition_variable m_notifier;
+
+      /// @brief - The steps waiting to be written.
+      std::vector<float> m_pending;
+
+      /// @brief - Whether a flush was requested.
+      bool m_flushRequested;
+
+      /// @brief - Whether the writing thread should stop.
+      bool m_stopRequested;
+
+      /// @brief - The writing thread.
+      std::thread m_thread;
+  };
+
+}
+
+#endif    /* STEP_WRITER_HH */
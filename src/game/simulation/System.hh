@@ -0,0 +1,64 @@
+#ifndef    SYSTEM_HH
+# define   SYSTEM_HH
+
+# include <string>
+# include <vector>
+
+namespace eqdif {
+
+  /// @brief - The computation method to evolve the data.
+  enum class SimulationMethod {
+    EULER,
+    RUNGE_KUTTA_4,
+    DORMAND_PRINCE_45,
+    ROSENBROCK_2,
+    BDF_2,
+    AUTOMATIC,
+    ADAMS_BASHFORTH_MOULTON,
+    VELOCITY_VERLET
+  };
+
+  /**
+   * @brief - Convert the simulation mode to a readable string.
+   * @param - the mode to convert.
+   * @return - the name of the simulation method.
+   */
+  std::string
+  toString(const SimulationMethod& method) noexcept;
+
+  /// @brief - In general an equation can look something like this:
+  /// dx = Ax - Bxy
+  /// dy = Cxy - Dy
+  /// To represent that in a generic way, we need a way to represent
+  /// the dependencies for a single coefficient (this is the `Bxy`).
+  /// In order to allow higher order dependencies like:
+  /// dx = Ax^2
+  /// Each dependency should be a composite of an index and some
+  /// exponent.
+  struct VariableDependency {
+    unsigned id;
+    float n;
+  };
+
+  struct SingleCoefficient {
+    float value;
+    std::vector<VariableDependency> dependencies;
+  };
+
+  /// Then the list of coefficients for a single variable and its
+  /// order: `1` if they give the derivative of the variable and `2`
+  /// if they give its second derivative.
+  struct Equation {
+    int order;
+    std::vector<SingleCoefficient> coeffs;
+  };
+
+  /// And finally the list of coefficients for each variable.
+  using System = std::vector<Equation>;
+
+  /// A range represents the bounds for a variable.
+  using Range = std::pair<float, float>;
+
+}
+
+#endif    /* SYSTEM_HH */
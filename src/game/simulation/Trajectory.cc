@@ -0,0 +1,792 @@
+
+# include "Trajectory.hh"
+# include <limits>
+# include <numeric>
+# include <algorithm>
+# include "ChunkWorker.hh"
+
+namespace {
+
+  /// @brief - The number of values stored for each variable in a
+  /// decimated bucket: the minimum, maximum and mean.
+  constexpr auto VALUES_PER_SUMMARY = 3u;
+
+  /// @brief - Marks the buffer of decoded values as empty.
+  constexpr auto NO_CHUNK = std::numeric_limits<std::size_t>::max();
+
+  /// @brief - The number of chunks kept allocated ahead of the one
+  /// being filled when the memory is prepared in the background. They
+  /// leave time to the worker to provide the next ones even when steps
+  /// are cheap to compute. Up to twice as many spare chunks are kept
+  /// when storage is recycled, the others are released.
+  constexpr auto SPARE_CHUNKS = 8u;
+
+  /// @brief - The number of decimated levels reserved in advance:
+  /// as each level covers twice as many steps as the previous one
+  /// this is never reached.
+  constexpr auto MAX_DECIMATED_LEVELS = 64u;
+
+  /// @brief - The size in bytes of the encoded columns of a chunk.
+  std::size_t
+  sizeOf(const eqdif::EncodedChunk& chunk) noexcept {
+    return std::accumulate(chunk.sizes.begin(), chunk.sizes.end(), std::size_t{0u});
+  }
+
+  unsigned
+  largestPowerOfTwoBelow(unsigned value) noexcept {
+    unsigned out = 1u;
+    while (out * 2u <= value) {
+      out *= 2u;
+    }
+
+    return out;
+  }
+
+}
+
+namespace eqdif {
+
+  RetentionPolicy
+  unlimitedRetention() noexcept {
+    return RetentionPolicy{
+      0u, // fullResolutionSteps
+      1u, // decimationFactor
+      1u  // bucketsPerLevel
+    };
+  }
+
+  Trajectory::Trajectory(unsigned variables,
+                         unsigned stepsPerChunk):
+    m_variables(variables),
+    m_stepsPerChunk(largestPowerOfTwoBelow(std::max(stepsPerChunk, 1u))),
+    m_size(0u),
+    m_first(0u),
+    m_chunks(),
+    m_encoded(),
+    m_mapping(),
+    m_policy(unlimitedRetention()),
+    m_levels(),
+
+    m_compression(noCompression()),
+    m_hotChunks(1u),
+    m_encodedSteps(0u),
+    m_encodedSize(0u),
+    m_decoded(),
+    m_decodedChunk(NO_CHUNK),
+    m_compressed(0u),
+    m_worker(),
+    m_chunkRequests(0u),
+    m_spareLevel()
+  {}
+
+  Trajectory::~Trajectory() = default;
+
+  Trajectory::Trajectory(Trajectory&&) = default;
+
+  Trajectory&
+  Trajectory::operator=(Trajectory&&) = default;
+
+  Trajectory
+  Trajectory::snapshot() const {
+    Trajectory out(m_variables, m_stepsPerChunk);
+
+    out.m_size = m_size;
+    out.m_first = m_first;
+    out.m_levels = m_levels;
+    out.m_mapping = m_mapping;
+
+    const std::size_t used = m_size - m_first;
+    const std::size_t complete = used / m_stepsPerChunk;
+
+    out.m_chunks.assign(m_chunks.begin(), m_chunks.begin() + complete);
+    out.m_encoded.assign(m_encoded.begin(), m_encoded.begin() + complete);
+    out.m_encodedSteps = m_encodedSteps;
+    out.m_encodedSize = m_encodedSize;
+    out.m_decoded.resize(m_decoded.size());
+
+    // The last chunk is still being filled: it is copied.
+    const std::size_t remaining = used - complete * m_stepsPerChunk;
+    if (remaining > 0u) {
+      const float* last = m_chunks[complete].get();
+
+      out.allocate();
+      std::copy(last, last + remaining * m_variables, out.m_chunks.back().get());
+    }
+
+    return out;
+  }
+
+  unsigned
+  Trajectory::variables() const noexcept {
+    return m_variables;
+  }
+
+  std::size_t
+  Trajectory::size() const noexcept {
+    return m_size;
+  }
+
+  std::size_t
+  Trajectory::first() const noexcept {
+    return m_first;
+  }
+
+  const std::vector<DecimatedLevel>&
+  Trajectory::levels() const noexcept {
+    return m_levels;
+  }
+
+  void
+  Trajectory::setRetentionPolicy(const RetentionPolicy& policy) {
+    m_policy = policy;
+
+    // The decimation factor should divide the size of a chunk so
+    // that buckets never span two chunks: as the size of a chunk
+    // is a power of two this is also the case of the factor.
+    m_policy.decimationFactor = std::min(
+      largestPowerOfTwoBelow(std::max(m_policy.decimationFactor, 2u)),
+      m_stepsPerChunk
+    );
+
+    // Levels should be able to hold at least the buckets produced
+    // by a chunk and keep an even number of them after merging.
+    m_policy.bucketsPerLevel = std::max(
+      m_policy.bucketsPerLevel,
+      2u * m_stepsPerChunk / m_policy.decimationFactor
+    );
+
+    if (m_policy.fullResolutionSteps > 0u && m_worker == nullptr) {
+      m_worker = std::make_unique<ChunkWorker>();
+    }
+
+    prepareMemory();
+    trim();
+  }
+
+  void
+  Trajectory::setCompression(const CompressionPolicy& policy, unsigned hotChunks) {
+    m_compression = policy;
+    m_hotChunks = std::max(hotChunks, 1u);
+
+    if (m_compression.encoding != Encoding::Raw && m_worker == nullptr) {
+      m_worker = std::make_unique<ChunkWorker>();
+    }
+
+    prepareMemory();
+    compress();
+  }
+
+  std::size_t
+  Trajectory::encodedSteps() const noexcept {
+    return m_encodedSteps;
+  }
+
+  std::size_t
+  Trajectory::encodedSize() const noexcept {
+    return m_encodedSize;
+  }
+
+  void
+  Trajectory::restore(std::size_t first, const std::vector<DecimatedLevel>& levels) {
+    m_size = first + (m_size - m_first);
+    m_first = first;
+    m_levels = levels;
+    m_compressed = 0u;
+
+    trim();
+  }
+
+  bool
+  Trajectory::restorable(std::size_t first, const std::vector<DecimatedLevel>& levels) const noexcept {
+    // Steps are decimated a chunk at a time.
+    if (first % m_stepsPerChunk != 0u) {
+      return false;
+    }
+
+    const std::size_t summary = VALUES_PER_SUMMARY * std::max(m_variables, 1u);
+    std::size_t end = first;
+
+    for (unsigned id = 0u ; id < levels.size() ; ++id) {
+      const DecimatedLevel& level = levels[id];
+
+      const bool validSpan = (
+        id == 0u ?
+        level.span >= 2u && level.span <= m_stepsPerChunk && (level.span & (level.span - 1u)) == 0u :
+        level.span / 2u == levels[id - 1u].span && level.span % 2u == 0u
+      );
+      if (!validSpan || level.buckets.size() % summary != 0u) {
+        return false;
+      }
+
+      // Each level ends where the next most recent one starts.
+      const std::size_t buckets = level.buckets.size() / summary;
+      if (level.first > end || (end - level.first) % level.span != 0u ||
+          (end - level.first) / level.span != buckets)
+      {
+        return false;
+      }
+
+      end = level.first;
+    }
+
+    return end == 0u;
+  }
+
+  void
+  Trajectory::assign(std::shared_ptr<MappedFile> file,
+                     std::size_t offset,
+                     std::size_t steps)
+  {
+    // Complete chunks are used in place: the owned chunks come
+    // after them and are used for the new steps.
+    float* data = reinterpret_cast<float*>(file->data() + offset);
+    const std::size_t chunkSize = static_cast<std::size_t>(m_stepsPerChunk) * m_variables;
+    const std::size_t mapped = steps / m_stepsPerChunk;
+
+    // Mapped chunks share the ownership of the file.
+    std::vector<std::shared_ptr<float[]>> chunks;
+    chunks.reserve(mapped + m_chunks.size());
+    for (std::size_t id = 0u ; id < mapped ; ++id) {
+      chunks.emplace_back(file, data + id * chunkSize);
+    }
+    chunks.insert(chunks.end(), m_chunks.begin(), m_chunks.end());
+
+    m_chunks.swap(chunks);
+    m_encoded.insert(m_encoded.begin(), mapped, nullptr);
+    m_mapping = std::move(file);
+    m_size = mapped * m_stepsPerChunk;
+    m_compressed = 0u;
+    prepareMemory();
+
+    // The last chunk is incomplete: the file might end before the
+    // end of the chunk so it can't be used in place.
+    const float* tail = data + mapped * chunkSize;
+    for (std::size_t id = mapped * m_stepsPerChunk ; id < steps ; ++id) {
+      push(tail);
+      tail += m_variables;
+    }
+  }
+
+  void
+  Trajectory::appendEncoded(std::shared_ptr<MappedFile> file,
+                            const Encoding& encoding,
+                            const char* const* columns,
+                            const std::uint64_t* sizes)
+  {
+    // Columns are located relatively to the first one.
+    auto encoded = std::make_shared<EncodedChunk>();
+    encoded->encoding = encoding;
+    encoded->external = reinterpret_cast<const std::uint8_t*>(columns[0]);
+
+    for (unsigned var = 0u ; var < m_variables ; ++var) {
+      encoded->offsets.push_back(reinterpret_cast<const std::uint8_t*>(columns[var]) - encoded->external);
+      encoded->sizes.push_back(sizes[var]);
+    }
+
+    m_encodedSteps += m_stepsPerChunk;
+    m_encodedSize += sizeOf(*encoded);
+    m_decoded.resize(static_cast<std::size_t>(m_stepsPerChunk) * m_variables);
+    m_mapping = std::move(file);
+
+    // The chunk is inserted before the spare chunks.
+    const std::size_t id = (m_size - m_first) / m_stepsPerChunk;
+
+    m_chunks.insert(m_chunks.begin() + id, nullptr);
+    m_encoded.insert(m_encoded.begin() + id, std::move(encoded));
+    m_size += m_stepsPerChunk;
+  }
+
+  unsigned
+  Trajectory::stepsPerChunk() const noexcept {
+    return m_stepsPerChunk;
+  }
+
+  bool
+  Trajectory::empty() const noexcept {
+    return m_size == 0u;
+  }
+
+  void
+  Trajectory::reset(unsigned variables) {
+    // Chunks can be kept if the size of the steps does not
+    // change: they will be overwritten. Chunks shared with a
+    // snapshot or with the mapped file are not kept.
+    std::vector<std::shared_ptr<float[]>> chunks;
+    if (variables == m_variables) {
+      for (std::shared_ptr<float[]>& chunk : m_chunks) {
+        if (chunk != nullptr && chunk.use_count() == 1) {
+          chunks.push_back(std::move(chunk));
+        }
+      }
+    }
+
+    m_chunks.swap(chunks);
+    m_mapping.reset();
+
+    m_encoded.assign(m_chunks.size(), nullptr);
+    m_encodedSteps = 0u;
+    m_encodedSize = 0u;
+    m_decodedChunk = NO_CHUNK;
+    m_compressed = 0u;
+
+    m_variables = variables;
+    m_size = 0u;
+    m_first = 0u;
+    m_levels.clear();
+
+    if (m_compression.encoding != Encoding::Raw) {
+      m_decoded.resize(static_cast<std::size_t>(m_stepsPerChunk) * m_variables);
+    }
+
+    prepareMemory();
+  }
+
+  void
+  Trajectory::reserve(std::size_t steps) {
+    const std::size_t chunks = (steps + m_stepsPerChunk - 1u) / m_stepsPerChunk;
+
+    m_chunks.reserve(chunks);
+    while (m_chunks.size() < chunks) {
+      allocate();
+    }
+  }
+
+  float*
+  Trajectory::append() {
+    // When starting a new chunk, check whether the oldest one can
+    // be decimated: in this case it is reused for the new steps.
+    // The chunk which just got complete might also need to be
+    // compressed. The work done in the background meanwhile is
+    // collected first.
+    if ((m_size - m_first) % m_stepsPerChunk == 0u) {
+      collect();
+      trim();
+      compress();
+      provision();
+    }
+
+    const std::size_t used = m_size - m_first;
+
+    const std::size_t chunk = used / m_stepsPerChunk;
+    const std::size_t offset = used % m_stepsPerChunk;
+
+    if (chunk >= m_chunks.size()) {
+      allocate();
+    }
+
+    ++m_size;
+
+    return m_chunks[chunk].get() + offset * m_variables;
+  }
+
+  void
+  Trajectory::push(const float* step) {
+    std::copy(step, step + m_variables, append());
+  }
+
+  const float*
+  Trajectory::step(std::size_t id) const noexcept {
+    const std::size_t offset = (id - m_first) % m_stepsPerChunk;
+    return chunk((id - m_first) / m_stepsPerChunk) + offset * m_variables;
+  }
+
+  std::size_t
+  Trajectory::contiguous(std::size_t id) const noexcept {
+    const std::size_t offset = (id - m_first) % m_stepsPerChunk;
+    return std::min<std::size_t>(m_size - id, m_stepsPerChunk - offset);
+  }
+
+  const float*
+  Trajectory::back() const noexcept {
+    return step(m_size - 1u);
+  }
+
+  float
+  Trajectory::value(std::size_t id, unsigned variable) const noexcept {
+    return step(id)[variable];
+  }
+
+  std::size_t
+  Trajectory::column(unsigned variable,
+                     std::size_t from,
+                     std::size_t count,
+                     float* out) const noexcept
+  {
+    if (from < m_first) {
+      const std::size_t skipped = m_first - from;
+      count = (count > skipped ? count - skipped : 0u);
+      from = m_first;
+    }
+
+    if (from >= m_size || variable >= m_variables) {
+      return 0u;
+    }
+
+    count = std::min(count, m_size - from);
+
+    // Process the range chunk by chunk so that we only need to
+    // compute the position of the chunk once.
+    std::size_t copied = 0u;
+    while (copied < count) {
+      const std::size_t id = from + copied - m_first;
+      const std::size_t offset = id % m_stepsPerChunk;
+      const std::size_t inChunk = std::min<std::size_t>(count - copied, m_stepsPerChunk - offset);
+
+      const float* data = chunk(id / m_stepsPerChunk) + offset * m_variables + variable;
+      for (std::size_t s = 0u ; s < inChunk ; ++s) {
+        out[copied + s] = data[s * m_variables];
+      }
+
+      copied += inChunk;
+    }
+
+    return copied;
+  }
+
+  void
+  Trajectory::allocate() {
+    m_chunks.emplace_back(new float[static_cast<std::size_t>(m_stepsPerChunk) * m_variables]());
+    m_encoded.emplace_back();
+  }
+
+  bool
+  Trajectory::mapped(const float* data) const noexcept {
+    if (m_mapping == nullptr) {
+      return false;
+    }
+
+    const float* begin = reinterpret_cast<const float*>(m_mapping->data());
+    const float* end = reinterpret_cast<const float*>(m_mapping->data() + m_mapping->size());
+
+    return data >= begin && data < end;
+  }
+
+  const float*
+  Trajectory::chunk(std::size_t id) const noexcept {
+    if (m_chunks[id] != nullptr) {
+      return m_chunks[id].get();
+    }
+
+    // Chunks are identified from the start of the trajectory so
+    // that the decoded values stay valid when chunks are decimated.
+    const std::size_t absolute = m_first / m_stepsPerChunk + id;
+    if (absolute != m_decodedChunk) {
+      const EncodedChunk& encoded = *m_encoded[id];
+      const std::uint8_t* data = (encoded.external != nullptr ? encoded.external : encoded.bytes.data());
+
+      for (unsigned var = 0u ; var < m_variables ; ++var) {
+        const bool valid = decodeColumn(
+          data + encoded.offsets[var],
+          encoded.sizes[var],
+          encoded.encoding,
+          m_stepsPerChunk,
+          m_variables,
+          m_decoded.data() + var
+        );
+
+        // A corrupted column is reset rather than leaving values
+        // partially decoded or from the previous chunk.
+        if (!valid) {
+          for (std::size_t step = 0u ; step < m_stepsPerChunk ; ++step) {
+            m_decoded[step * m_variables + var] = 0.0f;
+          }
+        }
+      }
+
+      m_decodedChunk = absolute;
+    }
+
+    return m_decoded.data();
+  }
+
+  void
+  Trajectory::compress() {
+    if (m_compression.encoding == Encoding::Raw) {
+      return;
+    }
+
+    m_decoded.resize(static_cast<std::size_t>(m_stepsPerChunk) * m_variables);
+
+    const std::size_t complete = (m_size - m_first) / m_stepsPerChunk;
+    if (complete <= m_hotChunks) {
+      return;
+    }
+
+    // Chunks are compressed from the oldest to the most recent one,
+    // starting after the ones already handled. Mapped chunks are not
+    // compressed as their memory is backed by the file anyway.
+    const std::size_t first = m_first / m_stepsPerChunk;
+    const std::size_t cold = first + complete - m_hotChunks;
+
+    for (std::size_t absolute = std::max(m_compressed, first) ; absolute < cold ; ++absolute) {
+      const std::size_t id = absolute - first;
+      const float* data = m_chunks[id].get();
+      if (data == nullptr || mapped(data)) {
+        continue;
+      }
+
+      if (m_worker == nullptr) {
+        install(id, encodeChunk(data, m_stepsPerChunk, m_variables, m_compression));
+        continue;
+      }
+
+      // In case the worker is busy the remaining chunks are handed
+      // to it when the next chunk is started.
+      if (!m_worker->encode(absolute, m_chunks[id], m_stepsPerChunk, m_variables, m_compression)) {
+        m_compressed = absolute;
+        return;
+      }
+    }
+
+    m_compressed = cold;
+  }
+
+  void
+  Trajectory::install(std::size_t id, std::shared_ptr<const EncodedChunk> encoded) {
+    m_encodedSteps += m_stepsPerChunk;
+    m_encodedSize += sizeOf(*encoded);
+    m_encoded[id] = std::move(encoded);
+
+    // The storage of the chunk is kept for the new steps unless
+    // a snapshot still refers to it or enough chunks are spare.
+    std::shared_ptr<float[]> storage = std::move(m_chunks[id]);
+    m_chunks[id] = nullptr;
+
+    if (storage.use_count() == 1 && m_chunks.size() < spareLimit()) {
+      m_chunks.push_back(std::move(storage));
+      m_encoded.emplace_back();
+    }
+  }
+
+  void
+  Trajectory::collect() {
+    if (m_worker == nullptr) {
+      return;
+    }
+
+    const std::size_t chunkSize = static_cast<std::size_t>(m_stepsPerChunk) * m_variables;
+    const std::size_t first = m_first / m_stepsPerChunk;
+
+    ChunkWork work{};
+    while (m_worker->collect(work)) {
+      switch (work.task) {
+        case ChunkTask::Encode: {
+          // The chunk may have been decimated or the trajectory reset
+          // since it was handed to the worker: it is then not found at
+          // the same position anymore.
+          const std::size_t id = work.chunk - first;
+          const bool current = (
+            work.encoded != nullptr && work.chunk >= first &&
+            id < m_chunks.size() && m_chunks[id] == work.storage
+          );
+
+          if (current) {
+            work.storage.reset();
+            install(id, std::move(work.encoded));
+          }
+          break;
+        }
+        case ChunkTask::Allocate:
+          if (work.storage != nullptr && work.values == chunkSize && m_chunks.size() < spareLimit()) {
+            m_chunks.push_back(std::move(work.storage));
+            m_encoded.emplace_back();
+          }
+          --m_chunkRequests;
+          break;
+        case ChunkTask::Reserve:
+          if (work.buckets.capacity() > m_spareLevel.capacity()) {
+            m_spareLevel.swap(work.buckets);
+          }
+          break;
+      }
+    }
+  }
+
+  void
+  Trajectory::provision() {
+    if (m_worker == nullptr) {
+      return;
+    }
+
+    // The chunks requested and not collected yet are accounted for
+    // so that they are not requested again.
+    const std::size_t needed = (m_size - m_first) / m_stepsPerChunk + SPARE_CHUNKS;
+    const std::size_t chunkSize = static_cast<std::size_t>(m_stepsPerChunk) * m_variables;
+
+    while (m_chunks.size() + m_chunkRequests < needed && m_worker->allocate(chunkSize)) {
+      ++m_chunkRequests;
+    }
+  }
+
+  std::size_t
+  Trajectory::spareLimit() const noexcept {
+    return (m_size - m_first) / m_stepsPerChunk + 2u * SPARE_CHUNKS;
+  }
+
+  void
+  Trajectory::prepareMemory() {
+    if (m_worker == nullptr) {
+      return;
+    }
+
+    if (m_policy.fullResolutionSteps > 0u) {
+      // The chunks at full resolution, the one being filled and the
+      // spare ones.
+      const std::size_t chunks = (
+        (m_policy.fullResolutionSteps + m_stepsPerChunk - 1u) / m_stepsPerChunk +
+        2u * SPARE_CHUNKS + 2u
+      );
+
+      m_chunks.reserve(chunks);
+      m_encoded.reserve(chunks);
+      m_levels.reserve(MAX_DECIMATED_LEVELS);
+
+      if (m_spareLevel.capacity() < levelCapacity()) {
+        m_spareLevel = std::vector<float>();
+        m_spareLevel.reserve(levelCapacity());
+      }
+    }
+
+    // The first spare chunks are allocated right away: the worker
+    // then only needs to provide the next ones.
+    const std::size_t needed = (m_size - m_first) / m_stepsPerChunk + SPARE_CHUNKS;
+    while (m_chunks.size() < needed) {
+      allocate();
+    }
+  }
+
+  std::size_t
+  Trajectory::levelCapacity() const noexcept {
+    // A level holds up to the maximum number of buckets plus the ones
+    // added before it is merged: half of the maximum for the levels
+    // fed by merging, and a chunk worth of buckets for the first one.
+    // Restored levels may use a factor as low as 2.
+    const std::size_t added = std::max(m_policy.bucketsPerLevel, m_stepsPerChunk) / 2u;
+    return (m_policy.bucketsPerLevel + added) * VALUES_PER_SUMMARY * m_variables;
+  }
+
+  std::vector<float>
+  Trajectory::takeLevel() {
+    std::vector<float> buckets;
+    buckets.swap(m_spareLevel);
+
+    // The storage for the next level is prepared in the background
+    // if possible, and allocated here otherwise.
+    if (m_worker != nullptr) {
+      m_worker->reserve(levelCapacity());
+    }
+    buckets.reserve(levelCapacity());
+
+    return buckets;
+  }
+
+  void
+  Trajectory::trim() {
+    if (m_policy.fullResolutionSteps == 0u) {
+      return;
+    }
+
+    while (m_size - m_first >= m_policy.fullResolutionSteps + m_stepsPerChunk) {
+      decimate();
+    }
+  }
+
+  void
+  Trajectory::decimate() {
+    // In case the decimated data was restored, keep the factor it
+    // was produced with so that buckets have a consistent span.
+    const std::size_t factor = (m_levels.empty() ? m_policy.decimationFactor : m_levels.front().span);
+
+    if (m_levels.empty()) {
+      m_levels.push_back(DecimatedLevel{factor, m_first, takeLevel()});
+    }
+
+    // Summarize the oldest chunk in the first level.
+    DecimatedLevel& level = m_levels.front();
+    const float* data = chunk(0u);
+
+    for (std::size_t bucket = 0u ; bucket < m_stepsPerChunk / factor ; ++bucket) {
+      const float* rows = data + bucket * factor * m_variables;
+
+      for (unsigned var = 0u ; var < m_variables ; ++var) {
+        float min = std::numeric_limits<float>::max();
+        float max = std::numeric_limits<float>::lowest();
+        float sum = 0.0f;
+
+        for (std::size_t row = 0u ; row < factor ; ++row) {
+          const float v = rows[row * m_variables + var];
+          min = std::min(min, v);
+          max = std::max(max, v);
+          sum += v;
+        }
+
+        level.buckets.push_back(min);
+        level.buckets.push_back(max);
+        level.buckets.push_back(sum / factor);
+      }
+    }
+
+    // Move the chunk at the end so that it can be reused. This
+    // is not possible if it is compressed, as its storage is then
+    // already reused, or if it is shared with a snapshot or with
+    // the mapped file.
+    if (m_chunks.front() == nullptr || m_chunks.front().use_count() > 1) {
+      if (m_encoded.front() != nullptr) {
+        m_encodedSteps -= m_stepsPerChunk;
+        m_encodedSize -= sizeOf(*m_encoded.front());
+      }
+
+      m_chunks.erase(m_chunks.begin());
+      m_encoded.erase(m_encoded.begin());
+    }
+    else {
+      std::rotate(m_chunks.begin(), m_chunks.begin() + 1, m_chunks.end());
+      std::rotate(m_encoded.begin(), m_encoded.begin() + 1, m_encoded.end());
+    }
+
+    m_first += m_stepsPerChunk;
+
+    overflow(0u);
+  }
+
+  void
+  Trajectory::overflow(unsigned id) {
+    const unsigned summary = VALUES_PER_SUMMARY * m_variables;
+    const std::size_t count = m_levels[id].buckets.size() / summary;
+
+    if (count <= m_policy.bucketsPerLevel) {
+      return;
+    }
+
+    if (id + 1u >= m_levels.size()) {
+      m_levels.push_back(DecimatedLevel{2u * m_levels[id].span, m_levels[id].first, takeLevel()});
+    }
+
+    DecimatedLevel& level = m_levels[id];
+    DecimatedLevel& next = m_levels[id + 1u];
+
+    // Move the oldest buckets by pairs so that only half of the
+    // maximum number of buckets remains in this level.
+    std::size_t moved = count - m_policy.bucketsPerLevel / 2u;
+    moved -= (moved % 2u);
+
+    for (std::size_t bucket = 0u ; bucket < moved ; bucket += 2u) {
+      const float* a = level.buckets.data() + bucket * summary;
+      const float* b = a + summary;
+
+      for (unsigned var = 0u ; var < m_variables ; ++var) {
+        const unsigned o = var * VALUES_PER_SUMMARY;
+
+        next.buckets.push_back(std::min(a[o], b[o]));
+        next.buckets.push_back(std::max(a[o + 1u], b[o + 1u]));
+        next.buckets.push_back(0.5f * (a[o + 2u] + b[o + 2u]));
+      }
+    }
+
+    level.buckets.erase(level.buckets.begin(), level.buckets.begin() + moved * summary);
+    level.first += moved * level.span;
+
+    overflow(id + 1u);
+  }
+
+}
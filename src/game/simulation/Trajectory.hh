@@ -0,0 +1,572 @@
+#ifndef    TRAJECTORY_HH
+# define   TRAJECTORY_HH
+
+# include <vector>
+# include <memory>
+# include <cstdint>
+# include <cstddef>
+# include "Codec.hh"
+# include "MappedFile.hh"
+
+namespace eqdif {
+
+  class ChunkWorker;
+
+  /// @brief - The default number of steps stored in each chunk
+  /// of a trajectory.
+  constexpr auto DEFAULT_STEPS_PER_CHUNK = 4096u;
+
+  /// @brief - Defines how much of the history of a trajectory is
+  /// kept at full resolution. Older steps are decimated: groups of
+  /// consecutive steps are replaced by their minimum, maximum and
+  /// mean values. The decimated data is organized in levels, each
+  /// one covering older data than the previous one with buckets
+  /// twice as large. When a level is full, its oldest buckets are
+  /// merged by pairs into the next level: the memory used thus only
+  /// grows with the logarithm of the number of steps.
+  struct RetentionPolicy {
+    /// @brief - The minimum number of steps kept at full resolution.
+    /// A value of `0` means that all steps are kept.
+    std::size_t fullResolutionSteps;
+
+    /// @brief - The number of steps summarized in a bucket of the
+    /// first level of decimation. Rounded to a power of two which
+    /// divides the number of steps per chunk, and at least `2`.
+    unsigned decimationFactor;
+
+    /// @brief - The maximum number of buckets in each level.
+    unsigned bucketsPerLevel;
+  };
+
+  /**
+   * @brief - Generate a retention policy keeping all the steps at
+   *          full resolution.
+   * @return - the retention policy.
+   */
+  RetentionPolicy
+  unlimitedRetention() noexcept;
+
+  /// @brief - A level of decimated data. Each bucket holds for each
+  /// variable its minimum, maximum and mean over `span` steps, laid
+  /// out as `[min, max, mean]` for each variable in order.
+  struct DecimatedLevel {
+    /// @brief - The number of steps summarized by each bucket.
+    std::size_t span;
+
+    /// @brief - The index of the first step covered by this level.
+    std::size_t first;
+
+    /// @brief - The summaries, `3 x variables` values per bucket.
+    std::vector<float> buckets;
+  };
+
+  /// @brief - A chunk of steps compressed column by column: the
+  /// values of each variable are encoded separately so that they can
+  /// be decoded on their own.
+  struct EncodedChunk {
+    /// @brief - The encoding of the columns.
+    Encoding encoding;
+
+    /// @brief - The offset of each column from the start of the
+    /// encoded data.
+    std::vector<std::size_t> offsets;
+
+    /// @brief - The size in bytes of each column.
+    std::vector<std::size_t> sizes;
+
+    /// @brief - The encoded columns, empty when they are stored in a
+    /// mapped file.
+    std::vector<std::uint8_t> bytes;
+
+    /// @brief - The start of the encoded columns when they are stored
+    /// in a mapped file, `null` when they are stored in `bytes`.
+    const std::uint8_t* external;
+  };
+
+  /// @brief - Stores the successive values of the variables of a
+  /// simulation. The steps are kept in fixed-size chunks, each of
+  /// them being a contiguous block of `steps x variables` values.
+  /// Inside a chunk the values of a step are contiguous, which
+  /// allows to compute a step directly in the store. The values of
+  /// a single variable can be extracted with the column accessors.
+  /// Compared to a vector of steps, this avoids an allocation and
+  /// the overhead of a vector for each step and never copies the
+  /// existing data when the trajectory grows.
+  ///
+  /// Depending on the retention policy, the oldest chunks may be
+  /// decimated when the trajectory grows: in this case only the
+  /// steps starting at `first()` are available at full resolution
+  /// and the older ones are described by the `levels()`. Indices
+  /// of steps are always counted from the start of the trajectory.
+  ///
+  /// The chunks which are not among the most recent ones can also
+  /// be compressed: they are decoded when accessed, in an internal
+  /// buffer which only holds a single chunk. The pointers returned
+  /// by `step` are thus only valid until the next access to a step.
+  ///
+  /// Complete chunks are never modified: a snapshot of a trajectory
+  /// can share them and only needs to copy the last chunk. A chunk
+  /// is only reused for new steps when no snapshot refers to it.
+  ///
+  /// Once a retention policy or a compression is defined, the old
+  /// chunks are compressed and the memory for the next chunks and
+  /// decimated levels is allocated by a background worker: adding
+  /// steps then does not allocate nor compress data inline.
+  class Trajectory {
+    public:
+
+      /**
+       * @brief - Create a new empty trajectory.
+       * @param variables - the number of variables of each step.
+       * @param stepsPerChunk - the number of steps in each chunk.
+       */
+      explicit
+      Trajectory(unsigned variables = 0u,
+                 unsigned stepsPerChunk = DEFAULT_STEPS_PER_CHUNK);
+
+      /**
+       * @brief - Release the trajectory, stopping its background
+       *          worker if any.
+       */
+      ~Trajectory();
+
+      Trajectory(const Trajectory&) = delete;
+
+      Trajectory(Trajectory&&);
+
+      Trajectory&
+      operator=(const Trajectory&) = delete;
+
+      Trajectory&
+      operator=(Trajectory&&);
+
+      /**
+       * @brief - Create a copy of this trajectory which shares the
+       *          complete chunks with it. This is cheap as only the
+       *          last chunk is copied. The snapshot keeps all the
+       *          steps and is not compressed further.
+       * @return - the snapshot of the trajectory.
+       */
+      Trajectory
+      snapshot() const;
+
+      /**
+       * @brief - The number of variables in each step.
+       * @return - the number of variables.
+       */
+      unsigned
+      variables() const noexcept;
+
+      /**
+       * @brief - The number of steps in the trajectory, including
+       *          the ones which have been decimated.
+       * @return - the number of steps.
+       */
+      std::size_t
+      size() const noexcept;
+
+      /**
+       * @brief - The index of the first step available at full
+       *          resolution.
+       * @return - the index of the first step.
+       */
+      std::size_t
+      first() const noexcept;
+
+      /**
+       * @brief - The levels of decimated data, from the most recent
+       *          one to the oldest one.
+       * @return - the decimated levels.
+       */
+      const std::vector<DecimatedLevel>&
+      levels() const noexcept;
+
+      /**
+       * @brief - Define the retention policy for this trajectory. It
+       *          is applied right away.
+       * @param policy - the retention policy.
+       */
+      void
+      setRetentionPolicy(const RetentionPolicy& policy);
+
+      /**
+       * @brief - Define how the chunks which are not among the most
+       *          recent ones are compressed. It is applied right away
+       *          to the chunks which are not compressed yet.
+       * @param policy - the compression policy.
+       * @param hotChunks - the number of the most recent chunks which
+       *                    are kept uncompressed. At least one chunk
+       *                    is always kept.
+       */
+      void
+      setCompression(const CompressionPolicy& policy, unsigned hotChunks);
+
+      /**
+       * @brief - The number of steps stored in compressed chunks.
+       * @return - the number of compressed steps.
+       */
+      std::size_t
+      encodedSteps() const noexcept;
+
+      /**
+       * @brief - The size of the compressed chunks.
+       * @return - the size in bytes of the compressed chunks.
+       */
+      std::size_t
+      encodedSize() const noexcept;
+
+      /**
+       * @brief - Restore decimated data for this trajectory, as it
+       *          was produced by the retention policy. The steps at
+       *          full resolution should already be there and are
+       *          considered to start at `first`.
+       * @param first - the index of the first full resolution step.
+       * @param levels - the decimated levels.
+       */
+      void
+      restore(std::size_t first, const std::vector<DecimatedLevel>& levels);
+
+      /**
+       * @brief - Check whether decimated data could have been produced
+       *          by the retention policy for this trajectory: the first
+       *          level should summarize a power of two of steps which
+       *          divides the size of a chunk, each level twice as much
+       *          as the previous one, and the levels should cover all
+       *          the steps before `first` without gaps.
+       * @param first - the index of the first full resolution step.
+       * @param levels - the decimated levels.
+       * @return - `true` if the data can be restored.
+       */
+      bool
+      restorable(std::size_t first, const std::vector<DecimatedLevel>& levels) const noexcept;
+
+      /**
+       * @brief - Use steps stored in a mapped file as the start of
+       *          the trajectory. The steps should be contiguous and
+       *          laid out as in a chunk: complete chunks are used in
+       *          place without copying them while the remaining steps
+       *          are copied. The trajectory should be empty.
+       * @param file - the mapped file, kept alive by the trajectory.
+       * @param offset - the offset of the first step in the file. It
+       *                 should be suitably aligned to access floats.
+       * @param steps - the number of steps in the file.
+       */
+      void
+      assign(std::shared_ptr<MappedFile> file,
+             std::size_t offset,
+             std::size_t steps);
+
+      /**
+       * @brief - Use a chunk of steps encoded in a mapped file as the
+       *          next chunk of the trajectory. The values are only
+       *          decoded when they are accessed. The trajectory should
+       *          only hold complete chunks, and all the encoded chunks
+       *          should come from the same file.
+       * @param file - the mapped file, kept alive by the trajectory.
+       * @param encoding - the encoding of the columns.
+       * @param columns - the position of the encoded values of each
+       *                  variable in the file.
+       * @param sizes - the size in bytes of each column.
+       */
+      void
+      appendEncoded(std::shared_ptr<MappedFile> file,
+                    const Encoding& encoding,
+                    const char* const* columns,
+                    const std::uint64_t* sizes);
+
+      /**
+       * @brief - The number of steps in each chunk.
+       * @return - the number of steps per chunk.
+       */
+      unsigned
+      stepsPerChunk() const noexcept;
+
+      /**
+       * @brief - Whether the trajectory contains any step.
+       * @return - `true` if there are no steps.
+       */
+      bool
+      empty() const noexcept;
+
+      /**
+       * @brief - Remove all the steps and decimated data and define
+       *          the number of variables for the new ones. The chunks
+       *          allocated by the trajectory are kept to be reused
+       *          while mapped data is released.
+       * @param variables - the number of variables of each step.
+       */
+      void
+      reset(unsigned variables);
+
+      /**
+       * @brief - Make sure that the trajectory can hold at least the
+       *          specified number of steps without allocating.
+       * @param steps - the number of steps to reserve.
+       */
+      void
+      reserve(std::size_t steps);
+
+      /**
+       * @brief - Add a new step at the end of the trajectory and
+       *          return a pointer to its values. The values are not
+       *          initialized.
+       * @return - a pointer to the `variables()` values of the step.
+       */
+      float*
+      append();
+
+      /**
+       * @brief - Add a copy of the input step at the end of the
+       *          trajectory.
+       * @param step - the `variables()` values of the step.
+       */
+      void
+      push(const float* step);
+
+      /**
+       * @brief - Access the values of a step.
+       * @param id - the index of the step, which should not be less
+       *             than `first()`.
+       * @return - a pointer to the `variables()` values of the step.
+       */
+      const float*
+      step(std::size_t id) const noexcept;
+
+      /**
+       * @brief - The number of steps stored contiguously from the
+       *          input one, including it: they can all be accessed
+       *          from the pointer returned by `step(id)`.
+       * @param id - the index of the step, which should be in the
+       *             range `[first(), size())`.
+       * @return - the number of contiguous steps.
+       */
+      std::size_t
+      contiguous(std::size_t id) const noexcept;
+
+      /**
+       * @brief - Access the values of the last step. The trajectory
+       *          should not be empty.
+       * @return - a pointer to the values of the last step.
+       */
+      const float*
+      back() const noexcept;
+
+      /**
+       * @brief - Access a single value of the trajectory.
+       * @param id - the index of the step.
+       * @param variable - the index of the variable.
+       * @return - the value of the variable at this step.
+       */
+      float
+      value(std::size_t id, unsigned variable) const noexcept;
+
+      /**
+       * @brief - Copy the values of a single variable for a range of
+       *          steps. The range should be at full resolution: it
+       *          is clamped to the steps after `first()`.
+       * @param variable - the index of the variable.
+       * @param from - the index of the first step.
+       * @param count - the number of steps to copy.
+       * @param out - output array with room for `count` values.
+       * @return - the number of values copied.
+       */
+      std::size_t
+      column(unsigned variable,
+             std::size_t from,
+             std::size_t count,
+             float* out) const noexcept;
+
+    private:
+
+      /**
+       * @brief - Allocate a new chunk at the end of the chunks.
+       */
+      void
+      allocate();
+
+      /**
+       * @brief - Whether the input data belongs to the mapped file.
+       * @param data - the data to check.
+       * @return - `true` if the data is in the mapped file.
+       */
+      bool
+      mapped(const float* data) const noexcept;
+
+      /**
+       * @brief - Access the values of a chunk, decoding it if needed.
+       *          The values of variables which can't be decoded are
+       *          set to `0`.
+       * @param id - the index of the chunk in the list of chunks.
+       * @return - the values of the steps of the chunk.
+       */
+      const float*
+      chunk(std::size_t id) const noexcept;
+
+      /**
+       * @brief - Compress the complete chunks which are not among the
+       *          most recent ones according to the compression policy.
+       *          When a background worker is available the chunks are
+       *          handed to it and only replaced when they are collected.
+       */
+      void
+      compress();
+
+      /**
+       * @brief - Use a compressed chunk in place of the values of the
+       *          chunk, which are kept to be reused if possible.
+       * @param id - the index of the chunk in the list of chunks.
+       * @param encoded - the compressed chunk.
+       */
+      void
+      install(std::size_t id, std::shared_ptr<const EncodedChunk> encoded);
+
+      /**
+       * @brief - Retrieve the work completed by the background worker:
+       *          compressed chunks, new chunks and storage for the
+       *          decimated levels. Results which no longer match the
+       *          content of the trajectory are discarded.
+       */
+      void
+      collect();
+
+      /**
+       * @brief - Request the background worker to allocate new chunks
+       *          if few spare chunks are left.
+       */
+      void
+      provision();
+
+      /**
+       * @brief - The number of chunks above which the storage of the
+       *          chunks which are recycled or provided by the worker is
+       *          released rather than kept as a spare chunk.
+       * @return - the maximum number of chunks.
+       */
+      std::size_t
+      spareLimit() const noexcept;
+
+      /**
+       * @brief - Prepare the memory needed to add steps without
+       *          allocating once a background worker is available: the
+       *          spare chunks and for the retention policy the list of
+       *          chunks, the decimated levels and the storage of the
+       *          next level.
+       */
+      void
+      prepareMemory();
+
+      /**
+       * @brief - The number of values a decimated level can hold before
+       *          and while being merged into the next one.
+       * @return - the capacity of a level.
+       */
+      std::size_t
+      levelCapacity() const noexcept;
+
+      /**
+       * @brief - Provide the storage for a new decimated level, using
+       *          the one prepared in advance if possible.
+       * @return - an empty vector with a capacity of `levelCapacity()`.
+       */
+      std::vector<float>
+      takeLevel();
+
+      /**
+       * @brief - Decimate the oldest chunks until the number of steps
+       *          at full resolution is consistent with the retention
+       *          policy.
+       */
+      void
+      trim();
+
+      /**
+       * @brief - Decimate the oldest chunk. The chunk is kept to be
+       *          reused.
+       */
+      void
+      decimate();
+
+      /**
+       * @brief - Merge the oldest buckets of the input level with the
+       *          next one if it holds too many buckets.
+       * @param level - the index of the level to check.
+       */
+      void
+      overflow(unsigned level);
+
+    private:
+
+      /// @brief - The number of variables in each step.
+      unsigned m_variables;
+
+      /// @brief - The number of steps in each chunk.
+      unsigned m_stepsPerChunk;
+
+      /// @brief - The number of steps in the trajectory.
+      std::size_t m_size;
+
+      /// @brief - The index of the first step at full resolution.
+      /// This is always a multiple of the number of steps per chunk.
+      std::size_t m_first;
+
+      /// @brief - The chunks holding the steps. The first chunk holds
+      /// the step `m_first`. Chunks past the one holding the last step
+      /// are allocated but not used yet. Each chunk either points to
+      /// the storage allocated by the trajectory or to the mapped file,
+      /// or is `null` if it is compressed.
+      std::vector<std::shared_ptr<float[]>> m_chunks;
+
+      /// @brief - The compressed version of each chunk, `null` for the
+      /// chunks which are not compressed.
+      std::vector<std::shared_ptr<const EncodedChunk>> m_encoded;
+
+      /// @brief - The file holding the mapped chunks and the encoded
+      /// chunks which are used in place, if any.
+      std::shared_ptr<MappedFile> m_mapping;
+
+      /// @brief - The retention policy.
+      RetentionPolicy m_policy;
+
+      /// @brief - The decimated levels.
+      std::vector<DecimatedLevel> m_levels;
+
+      /// @brief - How to compress the old chunks.
+      CompressionPolicy m_compression;
+
+      /// @brief - The number of recent chunks kept uncompressed.
+      unsigned m_hotChunks;
+
+      /// @brief - The number of steps in compressed chunks.
+      std::size_t m_encodedSteps;
+
+      /// @brief - The size in bytes of the compressed chunks.
+      std::size_t m_encodedSize;
+
+      /// @brief - Holds the values of the last compressed chunk which
+      /// was accessed.
+      mutable std::vector<float> m_decoded;
+
+      /// @brief - The absolute index of the chunk held in the decoded
+      /// buffer, counted from the start of the trajectory.
+      mutable std::size_t m_decodedChunk;
+
+      /// @brief - The absolute index of the first chunk which was not
+      /// considered for compression yet.
+      std::size_t m_compressed;
+
+      /// @brief - Compresses chunks and allocates memory in the
+      /// background, `null` until a retention policy or compression is
+      /// defined.
+      std::unique_ptr<ChunkWorker> m_worker;
+
+      /// @brief - The number of new chunks requested from the worker
+      /// and not collected yet.
+      unsigned m_chunkRequests;
+
+      /// @brief - The storage prepared for the next decimated level.
+      std::vector<float> m_spareLevel;
+  };
+
+}
+
+#endif    /* TRAJECTORY_HH */
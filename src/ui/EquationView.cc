@@ -101,10 +101,10 @@ namespace pge {
   }
 
   void
-  EquationView::handleSimulationStep(const std::vector<float>& step) {
-    if (step.size() < m_variableId) {
+  EquationView::handleSimulationStep(const float* step, unsigned variables) {
+    if (variables <= m_variableId) {
       warn(
-        "Simulation step only defines " + std::to_string(step.size()) +
+        "Simulation step only defines " + std::to_string(variables) +
         " variable, not enough for view binded to variable " +
         std::to_string(m_variableId)
       );
@@ -120,6 +120,14 @@ namespace pge {
       ++m_scaling.start;
     }
 
+    // Values before the start are not displayed anymore: drop them
+    // from time to time so that the view uses a bounded amount of
+    // memory.
+    if (m_scaling.start >= MAXIMUM_VALUES_DISPLAYED) {
+      m_values.erase(m_values.begin(), m_values.begin() + m_scaling.start);
+      m_scaling.start = 0u;
+    }
+
     updateViewport();
   }
 
@@ -138,6 +146,30 @@ namespace pge {
     };
   }
 
+  void
+  EquationView::handleSimulationLoaded(const eqdif::Trajectory& history) {
+    handleSimulationReset();
+
+    if (m_variableId >= history.variables()) {
+      warn(
+        "Loaded simulation only defines " + std::to_string(history.variables()) +
+        " variable(s), not enough for view binded to variable " +
+        std::to_string(m_variableId)
+      );
+
+      return;
+    }
+
+    // Only the latest values can be displayed, and only the ones
+    // which are still available at full resolution.
+    const std::size_t available = history.size() - history.first();
+    const std::size_t count = std::min<std::size_t>(available, MAXIMUM_VALUES_DISPLAYED);
+    m_values.resize(count);
+    m_values.resize(history.column(m_variableId, history.size() - count, count, m_values.data()));
+
+    updateViewport();
+  }
+
   void
   EquationView::updateViewport() {
     // https://stackoverflow.com/questions/22583391/peak-signal-detection-in-realtime-timeseries-data?page=1&tab=scoredesc#tab-top
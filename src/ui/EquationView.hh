@@ -5,6 +5,7 @@
 # include <core_utils/CoreObject.hh>
 # include "olcEngine.hh"
 # include "Menu.hh"
+# include "Trajectory.hh"
 
 namespace pge {
 
@@ -56,13 +57,15 @@ namespace pge {
                        std::vector<ActionShPtr>& actions);
 
       /**
-       * @brief - Internal slot used to handle when a new simulation step
-       *          is available. This will be used to update the history of
-       *          the variable attached to this view.
-       * @param step - the computed simulation step.
+       * @brief - Used to handle when a new simulation step is available.
+       *          This will be used to update the history of the variable
+       *          attached to this view. It should be called from the
+       *          thread rendering the view.
+       * @param step - the values of the computed simulation step.
+       * @param variables - the number of values in the step.
        */
       void
-      handleSimulationStep(const std::vector<float>& step);
+      handleSimulationStep(const float* step, unsigned variables);
 
       /**
        * @brief - Internal slot used to handle a reset event. This will
@@ -72,6 +75,15 @@ namespace pge {
       void
       handleSimulationReset();
 
+      /**
+       * @brief - Internal slot used to handle a simulation being loaded.
+       *          The values displayed in the view are replaced by the
+       *          latest ones of the history of the variable.
+       * @param history - the history of the loaded simulation.
+       */
+      void
+      handleSimulationLoaded(const eqdif::Trajectory& history);
+
     private:
 
       /**
@@ -0,0 +1,100 @@
+
+# include "PreviewMenu.hh"
+# include <vector>
+# include <algorithm>
+# include "ColorUtils.hh"
+
+namespace {
+
+  /// @brief - The colors used for the sparklines of the variables,
+  /// reused when there are more variables than colors.
+  const std::vector<olc::Pixel>&
+  sparklineColors() noexcept {
+    static const std::vector<olc::Pixel> colors = {
+      olc::ORANGE,
+      olc::APPLE_GREEN,
+      olc::CYAN,
+      olc::PINK,
+      olc::YELLOW,
+      olc::PURPLE,
+      olc::RED,
+      olc::BIDOOF
+    };
+
+    return colors;
+  }
+
+}
+
+namespace pge {
+
+  /// @brief - The margin in pixels between the sparklines and the
+  /// border of the menu.
+  constexpr auto SPARKLINE_MARGIN = 2;
+
+  PreviewMenu::PreviewMenu(const olc::vi2d& pos,
+                           const olc::vi2d& size,
+                           const std::string& name,
+                           const menu::BackgroundDesc& bg,
+                           const menu::MenuContentDesc& fg,
+                           const menu::Layout& layout,
+                           bool clickable,
+                           bool selectable,
+                           Menu* parent):
+    Menu(pos, size, name, bg, fg, layout, clickable, selectable, parent),
+
+    m_preview()
+  {}
+
+  void
+  PreviewMenu::setPreview(const eqdif::Preview& preview) {
+    m_preview = preview;
+  }
+
+  void
+  PreviewMenu::clearPreview() {
+    m_preview.reset(0u);
+  }
+
+  void
+  PreviewMenu::renderSelf(olc::PixelGameEngine* pge) const {
+    const unsigned buckets = m_preview.buckets();
+
+    if (buckets > 0u) {
+      const olc::vi2d offset(SPARKLINE_MARGIN, SPARKLINE_MARGIN);
+      const olc::vf2d pos = absolutePosition() + offset;
+      const olc::vf2d size = getSize() - 2 * offset;
+
+      const float w = size.x / buckets;
+
+      for (unsigned var = 0u ; var < m_preview.variables() ; ++var) {
+        // Each variable is scaled to the whole height of the menu.
+        float min = m_preview.min(0u, var), max = m_preview.max(0u, var);
+        for (unsigned id = 1u ; id < buckets ; ++id) {
+          min = std::min(min, m_preview.min(id, var));
+          max = std::max(max, m_preview.max(id, var));
+        }
+
+        const float range = (max > min ? max - min : 1.0f);
+
+        olc::Pixel color = sparklineColors()[var % sparklineColors().size()];
+        color.a = alpha::SemiOpaque;
+
+        for (unsigned id = 0u ; id < buckets ; ++id) {
+          const float low = (m_preview.min(id, var) - min) / range;
+          const float high = (m_preview.max(id, var) - min) / range;
+
+          // Constant values still produce a visible line.
+          const float h = std::max(size.y * (high - low), 1.0f);
+
+          olc::vf2d p{pos.x + id * w, pos.y + size.y * (1.0f - high)};
+          pge->FillRectDecal(p, olc::vf2d{w, h}, color);
+        }
+      }
+    }
+
+    // The content is displayed on top of the preview.
+    Menu::renderSelf(pge);
+  }
+
+}
@@ -0,0 +1,64 @@
+#ifndef    PREVIEW_MENU_HH
+# define   PREVIEW_MENU_HH
+
+# include <memory>
+# include "Menu.hh"
+# include "Preview.hh"
+
+namespace pge {
+
+  /// @brief - A menu displaying the preview of a simulation behind
+  /// its content: each variable is represented by a sparkline which
+  /// spans the whole menu and shows the range of values reached in
+  /// each bucket of the preview.
+  class PreviewMenu: public Menu {
+    public:
+
+      /**
+       * @brief - Create a new menu with the specified dimensions and
+       *          no preview. See the `Menu` class for details about
+       *          the arguments.
+       */
+      PreviewMenu(const olc::vi2d& pos,
+                  const olc::vi2d& size,
+                  const std::string& name,
+                  const menu::BackgroundDesc& bg,
+                  const menu::MenuContentDesc& fg,
+                  const menu::Layout& layout = menu::Layout::Horizontal,
+                  bool clickable = true,
+                  bool selectable = true,
+                  Menu* parent = nullptr);
+
+      /**
+       * @brief - Define the preview to display.
+       * @param preview - the preview of the simulation.
+       */
+      void
+      setPreview(const eqdif::Preview& preview);
+
+      /**
+       * @brief - Remove the preview displayed, if any.
+       */
+      void
+      clearPreview();
+
+    protected:
+
+      /**
+       * @brief - Draw the sparklines of the preview and then the
+       *          content of the menu on top of them.
+       * @param pge - the rendering engine to display the menu.
+       */
+      void
+      renderSelf(olc::PixelGameEngine* pge) const override;
+
+    private:
+
+      /// @brief - The preview to display, empty if there is none.
+      eqdif::Preview m_preview;
+  };
+
+  using PreviewMenuShPtr = std::shared_ptr<PreviewMenu>;
+}
+
+#endif    /* PREVIEW_MENU_HH */
@@ -0,0 +1,199 @@
+
+/**
+ * @brief - Checks that computing the steps of a simulation does
+ *          not allocate memory once it has started, whatever the
+ *          simulation method. The history is configured as in the
+ *          game, so that old steps are compressed and decimated.
+ *          The global allocation functions are replaced to count
+ *          the allocations of the thread running the simulation.
+ */
+
+# include <new>
+# include <chrono>
+# include <cstdio>
+# include <thread>
+# include <cstdlib>
+# include <fstream>
+# include <string>
+# include <iostream>
+# include "Simulation.hh"
+# include "Manager.hh"
+
+namespace {
+
+  /// @brief - The number of steps computed before counting, so
+  /// that the integrators reach their steady state.
+  constexpr auto WARMUP_STEPS = 64u;
+
+  /// @brief - The retention policy of the history, as in the game.
+  constexpr auto FULL_RESOLUTION_STEPS = 1u << 20u;
+  constexpr auto DECIMATION_FACTOR = 16u;
+  constexpr auto DECIMATED_BUCKETS_PER_LEVEL = 4096u;
+
+  /// @brief - The number of steps during which the allocations are
+  /// counted. Spans several retention windows so that old chunks are
+  /// compressed and decimated and several levels are created.
+  constexpr auto COUNTED_STEPS = 3u * FULL_RESOLUTION_STEPS;
+
+  /// @brief - The duration of each step in seconds.
+  constexpr auto STEP_DURATION = 0.01f;
+
+  /// @brief - The number of steps computed in a frame at the maximum
+  /// speed of the game. As in the launcher, the thread waits between
+  /// frames: this leaves time to the history to prepare its memory in
+  /// the background even with a single core.
+  constexpr auto STEPS_PER_FRAME = 1024u;
+  constexpr auto FRAME_PAUSE = std::chrono::microseconds(100);
+
+  /// @brief - The file holding the second order model.
+  constexpr auto OSCILLATOR_FILE = "allocations_test_oscillator.txt";
+
+  /**
+   * @brief - Write a harmonic oscillator `x'' = -x` in the legacy
+   *          format: the velocity Verlet method only handles second
+   *          order equations natively.
+   * @param file - the path of the file to write.
+   * @return - `true` if the file could be written.
+   */
+  bool
+  writeOscillator(const std::string& file) {
+    std::ofstream out(file, std::ios::binary);
+
+    // Variable `x` starting at `1` in `[-10, 10]`.
+    out << 1u << "\n" << "x\n" << 1.0f << "\n" << -10.0f << "\n" << 10.0f << "\n";
+
+    // Its acceleration is `-1 * x^1`.
+    const unsigned order = 2u;
+    const unsigned coefficients = 1u;
+    const float value = -1.0f;
+    const unsigned dependencies = 1u;
+    const unsigned variable = 0u;
+    const float exponent = 1.0f;
+
+    out.write(reinterpret_cast<const char*>(&order), sizeof(unsigned));
+    out.write(reinterpret_cast<const char*>(&coefficients), sizeof(unsigned));
+    out.write(reinterpret_cast<const char*>(&value), sizeof(float));
+    out.write(reinterpret_cast<const char*>(&dependencies), sizeof(unsigned));
+    out.write(reinterpret_cast<const char*>(&variable), sizeof(unsigned));
+    out.write(reinterpret_cast<const char*>(&exponent), sizeof(float));
+    out << "\n";
+
+    // A single step holding the initial value.
+    const float initial = 1.0f;
+
+    out << 1u << "\n";
+    out.write(reinterpret_cast<const char*>(&initial), sizeof(float));
+    out << "\n";
+
+    return out.good();
+  }
+
+  /// @brief - Whether the allocations of the current thread are
+  /// counted, and how many of them were made.
+  thread_local bool counting = false;
+  thread_local std::size_t allocations = 0u;
+
+}
+
+void*
+operator new(std::size_t size) {
+  if (counting) {
+    ++allocations;
+  }
+
+  void* ptr = std::malloc(size > 0u ? size : 1u);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  return ptr;
+}
+
+void
+operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void
+operator delete(void* ptr, std::size_t /*size*/) noexcept {
+  std::free(ptr);
+}
+
+int
+main(int /*argc*/, char** /*argv*/) {
+  const eqdif::SimulationMethod methods[] = {
+    eqdif::SimulationMethod::EULER,
+    eqdif::SimulationMethod::RUNGE_KUTTA_4,
+    eqdif::SimulationMethod::DORMAND_PRINCE_45,
+    eqdif::SimulationMethod::ROSENBROCK_2,
+    eqdif::SimulationMethod::BDF_2,
+    eqdif::SimulationMethod::AUTOMATIC,
+    eqdif::SimulationMethod::ADAMS_BASHFORTH_MOULTON,
+    eqdif::SimulationMethod::VELOCITY_VERLET
+  };
+
+  if (!writeOscillator(OSCILLATOR_FILE)) {
+    std::cerr << "Failed to write " << OSCILLATOR_FILE << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int status = EXIT_SUCCESS;
+
+  for (const eqdif::SimulationMethod& method : methods) {
+    eqdif::Simulation simulation(method);
+    if (method == eqdif::SimulationMethod::VELOCITY_VERLET) {
+      simulation.load(OSCILLATOR_FILE);
+    }
+
+    simulation.setRetentionPolicy(
+      eqdif::RetentionPolicy{
+        FULL_RESOLUTION_STEPS,      // fullResolutionSteps
+        DECIMATION_FACTOR,          // decimationFactor
+        DECIMATED_BUCKETS_PER_LEVEL // bucketsPerLevel
+      }
+    );
+    simulation.setCompression(
+      eqdif::losslessCompression(eqdif::Encoding::Delta),
+      eqdif::losslessCompression(eqdif::Encoding::Delta)
+    );
+
+    eqdif::time::Manager manager;
+    manager.increment(STEP_DURATION);
+
+    for (unsigned id = 0u ; id < WARMUP_STEPS ; ++id) {
+      simulation.simulate(manager);
+    }
+
+    allocations = 0u;
+    counting = true;
+
+    for (unsigned id = 0u ; id < COUNTED_STEPS ; ++id) {
+      simulation.simulate(manager);
+
+      if ((id + 1u) % STEPS_PER_FRAME == 0u) {
+        std::this_thread::sleep_for(FRAME_PAUSE);
+      }
+    }
+
+    counting = false;
+
+    const eqdif::Trajectory& history = simulation.getHistory();
+
+    std::cout
+      << eqdif::toString(method) << ": " << allocations
+      << " allocation(s) in " << COUNTED_STEPS << " step(s), "
+      << history.levels().size() << " decimated level(s), "
+      << history.encodedSteps() << " compressed step(s)"
+      << std::endl;
+
+    // The history should really have been decimated and compressed
+    // for the check to be meaningful.
+    if (allocations > 0u || history.levels().empty() || history.encodedSteps() == 0u) {
+      status = EXIT_FAILURE;
+    }
+  }
+
+  std::remove(OSCILLATOR_FILE);
+
+  return status;
+}
@@ -0,0 +1,192 @@
+/**
+ * @brief - Measures the throughput of loading a simulation from the
+ *          supported save formats: legacy files, and binary files with
+ *          raw, Delta and Xor encoded steps. The files are generated
+ *          from the same simulated steps. Binary files are mapped in
+ *          memory and only decoded when accessed, so the time to read
+ *          all the steps after loading is reported as well. As in the
+ *          logs of the loaders, the throughput is expressed in values
+ *          of the steps rather than in bytes of the file.
+ */
+
+# include <chrono>
+# include <cstdio>
+# include <limits>
+# include <string>
+# include <vector>
+# include <cstdlib>
+# include <fstream>
+# include <iostream>
+# include <algorithm>
+# include "Simulation.hh"
+# include "Manager.hh"
+
+namespace {
+
+  /// @brief - The number of steps stored in each file.
+  constexpr auto SIMULATED_STEPS = 1u << 21u;
+
+  /// @brief - The duration of each step in seconds.
+  constexpr auto STEP_DURATION = 0.01f;
+
+  /// @brief - The number of times each file is loaded: the fastest
+  /// load is reported so that the files are in the page cache.
+  constexpr auto REPETITIONS = 5u;
+
+  /// @brief - Convenience define for the clock used for measurements.
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief - The size of a file.
+   * @param file - the path of the file.
+   * @return - the size of the file in bytes.
+   */
+  std::size_t
+  fileSize(const std::string& file) {
+    std::ifstream in(file, std::ios::binary | std::ios::ate);
+    return static_cast<std::size_t>(in.tellg());
+  }
+
+  /**
+   * @brief - Write the history of a simulation in the legacy format.
+   *          The variables get no equation, which does not matter to
+   *          load the steps.
+   * @param file - the path of the file to write.
+   * @param simulation - the simulation holding the steps.
+   * @return - `true` if the file could be written.
+   */
+  bool
+  writeLegacy(const std::string& file, const eqdif::Simulation& simulation) {
+    const eqdif::Trajectory& history = simulation.getHistory();
+    const std::vector<std::string>& names = simulation.getVariableNames();
+    const float* initial = history.step(history.first());
+
+    std::ofstream out(file, std::ios::binary);
+
+    out << names.size() << "\n";
+
+    const unsigned order = 1u;
+    const unsigned coefficients = 0u;
+
+    for (unsigned var = 0u ; var < names.size() ; ++var) {
+      out << names[var] << "\n" << initial[var] << "\n" << -1.0e30f << "\n" << 1.0e30f << "\n";
+
+      out.write(reinterpret_cast<const char*>(&order), sizeof(unsigned));
+      out.write(reinterpret_cast<const char*>(&coefficients), sizeof(unsigned));
+      out << "\n";
+    }
+
+    out << history.size() - history.first() << "\n";
+
+    for (std::size_t id = history.first() ; id < history.size() ; ++id) {
+      out.write(reinterpret_cast<const char*>(history.step(id)), names.size() * sizeof(float));
+      out << "\n";
+    }
+
+    return out.good();
+  }
+
+  /**
+   * @brief - Load a file several times and print the best throughput
+   *          of loading it and of loading it and reading all its steps.
+   * @param format - the name of the format of the file.
+   * @param file - the path of the file.
+   * @return - `true` if the file holds all the simulated steps.
+   */
+  bool
+  benchmark(const std::string& format, const std::string& file) {
+    double load = std::numeric_limits<double>::max();
+    double scan = std::numeric_limits<double>::max();
+    std::size_t steps = 0u;
+    std::size_t bytes = 0u;
+
+    for (unsigned rep = 0u ; rep < REPETITIONS ; ++rep) {
+      eqdif::Simulation simulation(eqdif::SimulationMethod::RUNGE_KUTTA_4);
+
+      const Clock::time_point start = Clock::now();
+      simulation.load(file);
+      const Clock::time_point loaded = Clock::now();
+
+      // Read each variable over all the steps, as the renderer does.
+      const eqdif::Trajectory& history = simulation.getHistory();
+      std::vector<float> values(history.size());
+
+      for (unsigned var = 0u ; var < history.variables() ; ++var) {
+        history.column(var, history.first(), values.size(), values.data());
+      }
+      const Clock::time_point scanned = Clock::now();
+
+      load = std::min(load, std::chrono::duration<double>(loaded - start).count());
+      scan = std::min(scan, std::chrono::duration<double>(scanned - start).count());
+      steps = history.size() - history.first();
+      bytes = steps * history.variables() * sizeof(float);
+    }
+
+    const double megabytes = bytes / 1.0e6;
+
+    std::cout
+      << format << ": " << steps << " step(s), " << fileSize(file) / 1.0e6 << " MB on disk, "
+      << "load " << megabytes / load << " MB/s, "
+      << "load and read " << megabytes / scan << " MB/s"
+      << std::endl;
+
+    return steps == SIMULATED_STEPS;
+  }
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/) {
+  // The history is kept uncompressed so that the steps are saved
+  // as they are computed.
+  eqdif::Simulation simulation(eqdif::SimulationMethod::RUNGE_KUTTA_4);
+  simulation.setCompression(eqdif::noCompression(), eqdif::noCompression());
+
+  eqdif::time::Manager manager;
+  manager.increment(STEP_DURATION);
+
+  while (simulation.getHistory().size() < SIMULATED_STEPS) {
+    simulation.simulate(manager);
+  }
+
+  struct Format {
+    std::string name;
+    std::string file;
+    eqdif::CompressionPolicy compression;
+  };
+
+  const std::vector<Format> formats = {
+    {"raw", "load_benchmark_raw.sav", eqdif::noCompression()},
+    {"delta", "load_benchmark_delta.sav", eqdif::losslessCompression(eqdif::Encoding::Delta)},
+    {"xor", "load_benchmark_xor.sav", eqdif::losslessCompression(eqdif::Encoding::Xor)}
+  };
+
+  const std::string legacy = "load_benchmark_legacy.txt";
+  if (!writeLegacy(legacy, simulation)) {
+    std::cerr << "Failed to write " << legacy << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (const Format& format : formats) {
+    simulation.setCompression(eqdif::noCompression(), format.compression);
+    simulation.save(format.file);
+  }
+
+  int status = EXIT_SUCCESS;
+
+  if (!benchmark("legacy", legacy)) {
+    status = EXIT_FAILURE;
+  }
+  for (const Format& format : formats) {
+    if (!benchmark(format.name, format.file)) {
+      status = EXIT_FAILURE;
+    }
+  }
+
+  std::remove(legacy.c_str());
+  for (const Format& format : formats) {
+    std::remove(format.file.c_str());
+  }
+
+  return status;
+}